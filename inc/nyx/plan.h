@@ -3,6 +3,7 @@
 #include <nyx/registry.h>
 
 #include <map>
+#include <bitset>
 #include <vector>
 #include <stdint.h>
 
@@ -10,6 +11,9 @@
 namespace nyx {
 
 
+class Measure;
+
+
 class Stage {
   public:
     Stage();
@@ -51,7 +55,7 @@ class Stage {
     }
 
     bool isMatch() const {
-      return select.size() > 0;
+      return select.size() > 0 || spans.size() > 0;
     }
 
     bool isWildcard() const {
@@ -102,11 +106,37 @@ class Stage {
       return select;
     }
 
+    // key ranges of a match, by first key, to their last key and type
+    const std::map<uint64_t, std::pair<uint64_t, std::string>> &ranges() const {
+      return spans;
+    }
+
     nyx::syntax::Lexeme lexeme() const {
       return what;
     }
 
+    bool isFixedSize() const {
+      return width >= 0;
+    }
+
+    // bytes consumed by every repetition of the stage, -1 when not fixed
+    int64_t fixedSize() const {
+      return width;
+    }
+
+    // fewest bytes the stage can possibly consume
+    uint64_t minimumSize() const {
+      return least;
+    }
+
+    // bytes a non-empty match of the stage can begin with
+    const std::bitset<256> &firstBytes() const {
+      return lead;
+    }
+
   protected:
+    friend class Measure;
+
     std::unique_ptr<Stage>          stage;
     std::unique_ptr<Stage>          sub;
     std::string                     min;
@@ -116,7 +146,11 @@ class Stage {
     std::string                     ref;
     std::pair<uint8_t, uint8_t>     wild;
     std::map<uint64_t, std::string> select;
+    std::map<uint64_t, std::pair<uint64_t, std::string>> spans;
     nyx::syntax::Lexeme             what;
+    int64_t                         width;
+    uint64_t                        least;
+    std::bitset<256>                lead;
 
   private:
     void assignMetadata(const nyx::syntax::AbstractPatternElement &);
@@ -126,6 +160,10 @@ class Alternate {
   public:
     Alternate(const nyx::syntax::AbstractPatternElement &);
 
+    Stage &pattern() {
+      return *stage;
+    }
+
     const Stage &pattern() const {
       return *stage;
     }
@@ -139,6 +177,10 @@ class Pattern {
   public:
     Pattern(const nyx::syntax::AbstractPatternList &);
 
+    std::vector<Alternate> &alternates() {
+      return list;
+    }
+
     const std::vector<Alternate> &alternates() const {
       return list;
     }
@@ -246,13 +288,37 @@ class Rule {
       return val;
     }
 
+    bool isFixedSize() const {
+      return width >= 0;
+    }
+
+    // bytes consumed by every alternate of the rule, -1 when not fixed
+    int64_t fixedSize() const {
+      return width;
+    }
+
+    // fewest bytes any alternate of the rule can possibly consume
+    uint64_t minimumSize() const {
+      return least;
+    }
+
+    // bytes a non-empty match of any alternate can begin with
+    const std::bitset<256> &firstBytes() const {
+      return lead;
+    }
+
   protected:
+    friend class Measure;
+
     std::string ident;
     Pattern pat;
     Storage store;
     Code    enc;
     Code    dec;
     Code    val;
+    int64_t  width;
+    uint64_t least;
+    std::bitset<256> lead;
 };
 
 
@@ -299,6 +365,10 @@ class Namespace {
       return requires;
     }
 
+    std::vector<Rule> &rules() {
+      return members;
+    }
+
     const std::vector<Rule> &rules() const {
       return members;
     }
@@ -364,6 +364,9 @@ class AbstractMatchCaseElement: public AbstractElement {
   public:
     AbstractMatchCaseElement(std::shared_ptr<Token>                     key,
                              std::shared_ptr<AbstractIdentifierElement> value);
+    AbstractMatchCaseElement(std::shared_ptr<Token>                     key,
+                             std::shared_ptr<Token>                     last,
+                             std::shared_ptr<AbstractIdentifierElement> value);
 
     virtual ~AbstractMatchCaseElement();
 
@@ -378,6 +381,19 @@ class AbstractMatchCaseElement: public AbstractElement {
       return key_ptr;
     }
 
+    // the inclusive upper bound of a key range, null for a single key
+    auto last() {
+      return last_ptr;
+    }
+
+    auto last() const {
+      return last_ptr;
+    }
+
+    bool isRange() const {
+      return static_cast<bool>(last_ptr);
+    }
+
     auto value() {
       return value_ptr;
     }
@@ -388,6 +404,7 @@ class AbstractMatchCaseElement: public AbstractElement {
 
   protected:
     std::shared_ptr<Token>                     key_ptr;
+    std::shared_ptr<Token>                     last_ptr;
     std::shared_ptr<AbstractIdentifierElement> value_ptr;
 };
 
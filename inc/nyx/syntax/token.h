@@ -70,6 +70,7 @@ enum class Lexeme: int {
   OrAssignment,
   Pattern,
   PlusAssignment,
+  Range,
   RightShift,
   Storage,
   StringLiteral,
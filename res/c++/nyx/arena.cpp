@@ -0,0 +1,72 @@
+#include "nyx/arena.h"
+
+#include <new>
+
+
+namespace {
+
+
+thread_local nyx::arena *active = nullptr;
+
+
+}
+
+
+nyx::arena::arena(std::size_t block): blocks(nullptr), cursor(0), limit(0), chunk(block) {
+}
+
+
+nyx::arena::~arena() {
+  while(blocks) {
+    auto next = blocks->next;
+    ::operator delete(blocks);
+    blocks = next;
+  }
+}
+
+
+void nyx::arena::reset() {
+  if(blocks) {
+    while(blocks->next) {
+      auto next = blocks->next->next;
+      ::operator delete(blocks->next);
+      blocks->next = next;
+    }
+
+    cursor = reinterpret_cast<std::uintptr_t>(blocks + 1);
+    limit = reinterpret_cast<std::uintptr_t>(blocks) + blocks->size;
+  }
+}
+
+
+void *nyx::arena::refill(std::size_t size, std::size_t align) {
+  auto bytes = sizeof(header) + size + align;
+  if(bytes < chunk) {
+    bytes = chunk;
+  }
+
+  auto block = static_cast<header *>(::operator new(bytes));
+  block->next = blocks;
+  block->size = bytes;
+  blocks = block;
+
+  cursor = reinterpret_cast<std::uintptr_t>(block + 1);
+  limit = reinterpret_cast<std::uintptr_t>(block) + bytes;
+
+  return allocate(size, align);
+}
+
+
+nyx::arena *nyx::arena::current() {
+  return active;
+}
+
+
+nyx::arena::scope::scope(arena &target): previous(active) {
+  active = &target;
+}
+
+
+nyx::arena::scope::~scope() {
+  active = previous;
+}
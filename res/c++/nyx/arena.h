@@ -0,0 +1,122 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace nyx {
+
+
+// monotonic allocator: allocations bump a pointer through large blocks and are
+// only given back all at once, by reset() or when the arena is destroyed
+class arena {
+  public:
+    explicit arena(std::size_t block = 64 * 1024);
+    ~arena();
+
+    arena(const arena &) = delete;
+    arena &operator=(const arena &) = delete;
+
+    void *allocate(std::size_t size, std::size_t align) {
+      auto pos = (cursor + align - 1) & ~static_cast<std::uintptr_t>(align - 1);
+
+      if(pos + size > limit) {
+        return refill(size, align);
+      }
+
+      cursor = pos + size;
+      return reinterpret_cast<void *>(pos);
+    }
+
+    // drop everything allocated so far, keeping the newest block for reuse
+    void reset();
+
+    // the arena of the innermost scope on this thread, if any
+    static arena *current();
+
+    // makes an arena current on this thread for its lifetime
+    class scope {
+      public:
+        explicit scope(arena &);
+        ~scope();
+
+        scope(const scope &) = delete;
+        scope &operator=(const scope &) = delete;
+
+      private:
+        arena *previous;
+    };
+
+  private:
+    struct header {
+      header      *next;
+      std::size_t  size;
+    };
+
+    void *refill(std::size_t size, std::size_t align);
+
+    header         *blocks;
+    std::uintptr_t  cursor;
+    std::uintptr_t  limit;
+    std::size_t     chunk;
+};
+
+
+// allocator for containers in a decoded tree; it takes the current arena when
+// constructed and falls back on the heap when there is none
+template<typename T>
+class arena_allocator {
+  public:
+    typedef T value_type;
+
+    arena_allocator(): owner(arena::current()) {
+    }
+
+    explicit arena_allocator(arena &source): owner(&source) {
+    }
+
+    template<typename U>
+    arena_allocator(const arena_allocator<U> &that): owner(that.owner) {
+    }
+
+    T *allocate(std::size_t count) {
+      if(owner) {
+        return static_cast<T *>(owner->allocate(count * sizeof(T), alignof(T)));
+      }
+
+      return static_cast<T *>(::operator new(count * sizeof(T)));
+    }
+
+    void deallocate(T *ptr, std::size_t) {
+      if(!owner) {
+        ::operator delete(ptr);
+      }
+    }
+
+    template<typename U>
+    bool operator==(const arena_allocator<U> &that) const {
+      return owner == that.owner;
+    }
+
+    template<typename U>
+    bool operator!=(const arena_allocator<U> &that) const {
+      return owner != that.owner;
+    }
+
+  private:
+    template<typename U>
+    friend class arena_allocator;
+
+    arena *owner;
+};
+
+
+template<typename T>
+using arena_vector = std::vector<T, arena_allocator<T>>;
+
+typedef std::basic_string<char, std::char_traits<char>, arena_allocator<char>> arena_string;
+
+
+}
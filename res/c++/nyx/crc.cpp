@@ -1,89 +1,70 @@
 #include "nyx/crc.h"
 
-std::uint8_t
-nyx::crc::crc8(std::uint8_t                     poly, std::uint8_t seed,
-               const std::vector<std::uint8_t> &data, std::uint8_t mask) {
-  auto crc = seed;
 
-  for(auto byte : data) {
-    crc ^= byte;
+namespace {
 
-    for(int bit = 0; bit < 8; ++bit) {
-      if(crc & 0x80U) {
-        crc = (crc << 1) ^ poly;
-      }
-      else {
-        crc <<= 1;
-      }
-    }
-  }
 
-  return crc ^ mask;
-}
+// most significant bit first crc, a byte at a time through a table that is
+// built on first use and kept per thread for the polynomial seen last
+template<typename T>
+T checksum(T poly, T seed, const nyx::view &data, T mask) {
+  const int shift = sizeof(T) * 8 - 8;
+  const T   top   = static_cast<T>(1) << (sizeof(T) * 8 - 1);
 
+  thread_local T    table[256];
+  thread_local T    cached = 0;
+  thread_local bool ready  = false;
 
-std::uint16_t
-nyx::crc::crc16(std::uint16_t                    poly, std::uint16_t seed,
-                const std::vector<std::uint8_t> &data, std::uint16_t mask) {
-  auto crc = seed;
+  if(!ready || cached != poly) {
+    for(unsigned idx = 0; idx < 256; ++idx) {
+      T crc = static_cast<T>(static_cast<T>(idx) << shift);
 
-  for(auto byte : data) {
-    crc ^= static_cast<std::uint16_t>(byte) << 8;
-
-    for(int bit = 0; bit < 8; ++bit) {
-      if(crc & 0x8000U) {
-        crc = (crc << 1) ^ poly;
-      }
-      else {
-        crc <<= 1;
+      for(int bit = 0; bit < 8; ++bit) {
+        crc = (crc & top) ? static_cast<T>((crc << 1) ^ poly) : static_cast<T>(crc << 1);
       }
-    }
-  }
 
-  return crc ^ mask;
-}
+      table[idx] = crc;
+    }
 
+    cached = poly;
+    ready = true;
+  }
 
-std::uint32_t
-nyx::crc::crc32(std::uint32_t                    poly, std::uint32_t seed,
-                const std::vector<std::uint8_t> &data, std::uint32_t mask) {
   auto crc = seed;
-
   for(auto byte : data) {
-    crc ^= static_cast<std::uint32_t>(byte) << 24;
-
-    for(int bit = 0; bit < 8; ++bit) {
-      if(crc & 0x80000000U) {
-        crc = (crc << 1) ^ poly;
-      }
-      else {
-        crc <<= 1;
-      }
-    }
+    crc = static_cast<T>((sizeof(T) > 1 ? crc << 8 : 0) ^ table[((crc >> shift) ^ byte) & 0xFF]);
   }
 
   return crc ^ mask;
 }
 
 
-std::uint64_t
-nyx::crc::crc64(std::uint64_t                    poly, std::uint8_t seed,
-                const std::vector<std::uint8_t> &data, std::uint8_t mask) {
-  auto crc = seed;
+}
 
-  for(auto byte : data) {
-    crc ^= static_cast<std::uint64_t>(byte) << 56;
 
-    for(int bit = 0; bit < 8; ++bit) {
-      if(crc & 0x8000000000000000UL) {
-        crc = (crc << 1) ^ poly;
-      }
-      else {
-        crc <<= 1;
-      }
-    }
-  }
+std::uint8_t
+nyx::crc::crc8(std::uint8_t    poly, std::uint8_t seed,
+               const nyx::view &data, std::uint8_t mask) {
+  return checksum<std::uint8_t>(poly, seed, data, mask);
+}
 
-  return crc ^ mask;
+
+std::uint16_t
+nyx::crc::crc16(std::uint16_t   poly, std::uint16_t seed,
+                const nyx::view &data, std::uint16_t mask) {
+  return checksum<std::uint16_t>(poly, seed, data, mask);
 }
 
+
+std::uint32_t
+nyx::crc::crc32(std::uint32_t   poly, std::uint32_t seed,
+                const nyx::view &data, std::uint32_t mask) {
+  return checksum<std::uint32_t>(poly, seed, data, mask);
+}
+
+
+std::uint64_t
+nyx::crc::crc64(std::uint64_t   poly, std::uint64_t seed,
+                const nyx::view &data, std::uint64_t mask) {
+  return checksum<std::uint64_t>(poly, seed, data, mask);
+}
@@ -1,6 +1,7 @@
 #pragma once
 
-#include <vector>
+#include "nyx/runtime.h"
+
 #include <cstdint>
 
 
@@ -9,21 +10,64 @@ namespace nyx {
 
 
     std::uint8_t
-    crc8(std::uint8_t                     poly, std::uint8_t seed,
-         const std::vector<std::uint8_t> &data, std::uint8_t mask);
+    crc8(std::uint8_t    poly, std::uint8_t seed,
+         const nyx::view &data, std::uint8_t mask);
 
     std::uint16_t
-    crc16(std::uint16_t                    poly, std::uint16_t seed,
-          const std::vector<std::uint8_t> &data, std::uint16_t mask);
+    crc16(std::uint16_t   poly, std::uint16_t seed,
+          const nyx::view &data, std::uint16_t mask);
 
     std::uint32_t
-    crc32(std::uint32_t                    poly, std::uint32_t seed,
-          const std::vector<std::uint8_t> &data, std::uint32_t mask);
+    crc32(std::uint32_t   poly, std::uint32_t seed,
+          const nyx::view &data, std::uint32_t mask);
 
     std::uint64_t
-    crc64(std::uint64_t                    poly, std::uint8_t seed,
-          const std::vector<std::uint8_t> &data, std::uint8_t mask);
+    crc64(std::uint64_t   poly, std::uint64_t seed,
+          const nyx::view &data, std::uint64_t mask);
+
+
+    // a checksum carries over from one run of bytes to the next, so a chain is
+    // summed a part at a time and masked once at the end
+
+    template<std::size_t N>
+    std::uint8_t
+    crc8(std::uint8_t poly, std::uint8_t seed,
+         const nyx::chain<N> &data, std::uint8_t mask) {
+      for(std::size_t idx = 0; idx < N; ++idx) {
+        seed = crc8(poly, seed, data.part(idx), 0);
+      }
+      return seed ^ mask;
+    }
 
+    template<std::size_t N>
+    std::uint16_t
+    crc16(std::uint16_t poly, std::uint16_t seed,
+          const nyx::chain<N> &data, std::uint16_t mask) {
+      for(std::size_t idx = 0; idx < N; ++idx) {
+        seed = crc16(poly, seed, data.part(idx), 0);
+      }
+      return seed ^ mask;
+    }
+
+    template<std::size_t N>
+    std::uint32_t
+    crc32(std::uint32_t poly, std::uint32_t seed,
+          const nyx::chain<N> &data, std::uint32_t mask) {
+      for(std::size_t idx = 0; idx < N; ++idx) {
+        seed = crc32(poly, seed, data.part(idx), 0);
+      }
+      return seed ^ mask;
+    }
+
+    template<std::size_t N>
+    std::uint64_t
+    crc64(std::uint64_t poly, std::uint64_t seed,
+          const nyx::chain<N> &data, std::uint64_t mask) {
+      for(std::size_t idx = 0; idx < N; ++idx) {
+        seed = crc64(poly, seed, data.part(idx), 0);
+      }
+      return seed ^ mask;
+    }
 
   }
 }
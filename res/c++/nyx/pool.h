@@ -0,0 +1,196 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <type_traits>
+
+
+namespace nyx {
+
+
+// vector of decoded sub-rules whose elements outlive clear(): they are kept,
+// with whatever their own members have allocated, and reset() for reuse as
+// the vector grows back over them
+template<typename T>
+class reuse_vector {
+  public:
+    typedef T                                       value_type;
+    typedef typename std::vector<T>::iterator       iterator;
+    typedef typename std::vector<T>::const_iterator const_iterator;
+
+    reuse_vector(): used(0) {
+    }
+
+    std::size_t size() const {
+      return used;
+    }
+
+    bool empty() const {
+      return used == 0;
+    }
+
+    iterator begin() {
+      return items.begin();
+    }
+
+    iterator end() {
+      return items.begin() + used;
+    }
+
+    const_iterator begin() const {
+      return items.begin();
+    }
+
+    const_iterator end() const {
+      return items.begin() + used;
+    }
+
+    T &operator[](std::size_t idx) {
+      return items[idx];
+    }
+
+    const T &operator[](std::size_t idx) const {
+      return items[idx];
+    }
+
+    T &back() {
+      return items[used - 1];
+    }
+
+    const T &back() const {
+      return items[used - 1];
+    }
+
+    void reserve(std::size_t count) {
+      items.reserve(count);
+    }
+
+    T &emplace_back() {
+      if(used < items.size()) {
+        items[used].reset();
+      }
+      else {
+        items.emplace_back();
+      }
+
+      return items[used++];
+    }
+
+    void pop_back() {
+      --used;
+    }
+
+    void resize(std::size_t count) {
+      for(auto idx = used; idx < count && idx < items.size(); ++idx) {
+        items[idx].reset();
+      }
+      if(items.size() < count) {
+        items.resize(count);
+      }
+
+      used = count;
+    }
+
+    void clear() {
+      used = 0;
+    }
+
+    // destroy the elements kept beyond size()
+    void shrink() {
+      items.resize(used);
+    }
+
+  private:
+    std::vector<T> items;
+    std::size_t    used;
+};
+
+
+template<typename T>
+class object_pool;
+
+
+namespace detail {
+
+
+// whether T was generated with -O recycle, which alone makes reset() keep
+// what nested members hold
+template<typename T, typename = void>
+struct recycled: std::false_type {
+};
+
+template<typename T>
+struct recycled<T, decltype(void(T::recycled))>: std::integral_constant<bool, T::recycled> {
+};
+
+
+}
+
+
+// hands an object back to the pool of the releasing thread
+template<typename T>
+struct recycler {
+  void operator()(T *obj) const {
+    object_pool<T>::release(obj);
+  }
+};
+
+
+template<typename T>
+using pooled = std::unique_ptr<T, recycler<T>>;
+
+
+// per thread free list of decoded objects; released objects are reset(), so
+// those acquired later start empty but keep the capacity of everything they
+// hold
+template<typename T>
+class object_pool {
+  static_assert(detail::recycled<T>::value,
+                "nyx::object_pool needs classes generated with -O recycle");
+
+  public:
+    static pooled<T> acquire() {
+      auto &list = spare();
+
+      if(list.empty()) {
+        return pooled<T>(new T());
+      }
+
+      auto obj = list.back().release();
+      list.pop_back();
+      return pooled<T>(obj);
+    }
+
+    static void release(T *obj) {
+      auto &list = spare();
+
+      if(list.size() < limit()) {
+        obj->reset();
+        list.emplace_back(obj);
+      }
+      else {
+        delete obj;
+      }
+    }
+
+    // most objects this thread keeps for reuse, 64 unless changed
+    static std::size_t &limit() {
+      thread_local std::size_t most = 64;
+      return most;
+    }
+
+    // free the objects this thread keeps
+    static void trim() {
+      spare().clear();
+    }
+
+  private:
+    static std::vector<std::unique_ptr<T>> &spare() {
+      thread_local std::vector<std::unique_ptr<T>> list;
+      return list;
+    }
+};
+
+
+}
@@ -0,0 +1,56 @@
+#include "nyx/profile.h"
+
+#include <mutex>
+#include <fstream>
+
+
+namespace {
+
+
+std::mutex                  lock;
+nyx::profile::counters     *head = nullptr;
+
+
+}
+
+
+nyx::profile::counters::counters(const char *name, std::initializer_list<const char *> names):
+  rule(name), labels(names), counts(names.size()), next(nullptr) {
+  std::lock_guard<std::mutex> guard(lock);
+  next = head;
+  head = this;
+}
+
+
+void nyx::profile::write(std::ostream &out) {
+  std::lock_guard<std::mutex> guard(lock);
+
+  for(auto iter = head; iter; iter = iter->next) {
+    for(std::size_t idx = 0; idx < iter->labels.size(); ++idx) {
+      out << iter->rule << ' ' << iter->labels[idx] << ' ' <<
+             iter->counts[idx].load(std::memory_order_relaxed) << '\n';
+    }
+  }
+}
+
+
+bool nyx::profile::save(const std::string &path) {
+  std::ofstream ofs(path.c_str(), std::ios::out | std::ios::trunc);
+
+  if(ofs) {
+    write(ofs);
+  }
+
+  return static_cast<bool>(ofs);
+}
+
+
+void nyx::profile::reset() {
+  std::lock_guard<std::mutex> guard(lock);
+
+  for(auto iter = head; iter; iter = iter->next) {
+    for(auto &count : iter->counts) {
+      count.store(0, std::memory_order_relaxed);
+    }
+  }
+}
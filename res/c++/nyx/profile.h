@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <initializer_list>
+
+
+namespace nyx {
+  namespace profile {
+
+
+    // hit counts kept by one instrumented consume; it joins the profile the
+    // first time that consume runs
+    class counters {
+      public:
+        counters(const char *rule, std::initializer_list<const char *> labels);
+
+        counters(const counters &) = delete;
+        counters &operator=(const counters &) = delete;
+
+        void hit(std::size_t idx) {
+          counts[idx].fetch_add(1, std::memory_order_relaxed);
+        }
+
+      private:
+        friend void write(std::ostream &);
+        friend void reset();
+
+        const char                               *rule;
+        std::vector<const char *>                 labels;
+        std::vector<std::atomic<std::uint64_t>>   counts;
+        counters                                 *next;
+    };
+
+
+    // every count so far, one "rule label count" line each, which is what
+    // nyx --profile reads back
+    void write(std::ostream &);
+
+    // write() to a file, false when it cannot be written
+    bool save(const std::string &path);
+
+    // zero every count
+    void reset();
+
+
+  }
+}
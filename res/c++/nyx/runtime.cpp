@@ -1,31 +1,310 @@
 #include "nyx/runtime.h"
 
 
-std::vector<std::uint8_t> concat(const std::string &one, const std::string &two) {
-  std::vector<std::uint8_t> retVal(one.begin(), one.end());
-  retVal.insert(retVal.end(), two.begin(), two.end());
-  return retVal;
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#  define NYX_X86_DISPATCH 1
+#  include <immintrin.h>
+#endif
+
+
+namespace {
+
+
+typedef void (*swapper)(std::uint8_t *, const std::uint8_t *, std::size_t);
+
+
+template<typename RAW>
+void swapScalar(std::uint8_t *dst, const std::uint8_t *src, std::size_t count) {
+  for(std::size_t idx = 0; idx < count; ++idx) {
+    RAW raw;
+    std::memcpy(&raw, src + idx * sizeof(RAW), sizeof(RAW));
+    raw = nyx::detail::bswap(raw);
+    std::memcpy(dst + idx * sizeof(RAW), &raw, sizeof(RAW));
+  }
+}
+
+
+#ifdef NYX_X86_DISPATCH
+// pshufb control that reverses every SIZE byte lane of a 128 bit register
+template<std::size_t SIZE>
+struct Reversal {
+  Reversal() {
+    for(std::size_t idx = 0; idx < sizeof(mask); ++idx) {
+      auto lane = idx % 16;
+      mask[idx] = static_cast<std::uint8_t>((lane / SIZE) * SIZE + (SIZE - 1 - lane % SIZE));
+    }
+  }
+
+  alignas(32) std::uint8_t mask[32];
+};
+
+
+template<typename RAW>
+__attribute__((target("ssse3")))
+void swapSsse3(std::uint8_t *dst, const std::uint8_t *src, std::size_t count) {
+  static const Reversal<sizeof(RAW)> reversal;
+  const auto mask = _mm_load_si128(reinterpret_cast<const __m128i *>(reversal.mask));
+  std::size_t idx = 0, max = count * sizeof(RAW);
+
+  for(; idx + 16 <= max; idx += 16) {
+    auto val = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + idx));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + idx), _mm_shuffle_epi8(val, mask));
+  }
+
+  swapScalar<RAW>(dst + idx, src + idx, (max - idx) / sizeof(RAW));
+}
+
+
+template<typename RAW>
+__attribute__((target("avx2")))
+void swapAvx2(std::uint8_t *dst, const std::uint8_t *src, std::size_t count) {
+  static const Reversal<sizeof(RAW)> reversal;
+  const auto mask = _mm256_load_si256(reinterpret_cast<const __m256i *>(reversal.mask));
+  std::size_t idx = 0, max = count * sizeof(RAW);
+
+  for(; idx + 32 <= max; idx += 32) {
+    auto val = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + idx));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + idx), _mm256_shuffle_epi8(val, mask));
+  }
+
+  swapScalar<RAW>(dst + idx, src + idx, (max - idx) / sizeof(RAW));
+}
+#endif
+
+
+typedef std::size_t (*scanner)(const std::uint8_t *, std::size_t, std::uint8_t, std::uint8_t);
+
+
+std::size_t scanScalar(const std::uint8_t *data, std::size_t size, std::uint8_t mask, std::uint8_t value) {
+  std::size_t idx = 0;
+
+  while(idx < size && (data[idx] & mask) == value) {
+    ++idx;
+  }
+
+  return idx;
+}
+
+
+#ifdef NYX_X86_DISPATCH
+__attribute__((target("sse2")))
+std::size_t scanSse2(const std::uint8_t *data, std::size_t size, std::uint8_t mask, std::uint8_t value) {
+  const auto bits = _mm_set1_epi8(static_cast<char>(mask));
+  const auto want = _mm_set1_epi8(static_cast<char>(value));
+  std::size_t idx = 0;
+
+  for(; idx + 16 <= size; idx += 16) {
+    auto val = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + idx));
+    auto hit = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(val, bits), want)));
+    if(hit != 0xFFFFU) {
+      return idx + __builtin_ctz(~hit);
+    }
+  }
+
+  return idx + scanScalar(data + idx, size - idx, mask, value);
+}
+
+
+__attribute__((target("avx2")))
+std::size_t scanAvx2(const std::uint8_t *data, std::size_t size, std::uint8_t mask, std::uint8_t value) {
+  const auto bits = _mm256_set1_epi8(static_cast<char>(mask));
+  const auto want = _mm256_set1_epi8(static_cast<char>(value));
+  std::size_t idx = 0;
+
+  for(; idx + 32 <= size; idx += 32) {
+    auto val = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + idx));
+    auto hit = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(val, bits), want)));
+    if(hit != 0xFFFFFFFFU) {
+      return idx + __builtin_ctz(~hit);
+    }
+  }
+
+  return idx + scanSse2(data + idx, size - idx, mask, value);
+}
+#endif
+
+
+typedef std::size_t (*filter)(const std::uint8_t *, std::size_t, std::size_t,
+                              const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::size_t);
+
+
+// next offset whose byte and the one after it match the first two bytes of a
+// string; any is 0xFF for strings of one byte, whose second byte is not looked at
+std::size_t filterScalar(const std::uint8_t *data, std::size_t size, std::size_t from,
+                         const std::uint8_t *first, const std::uint8_t *second, const std::uint8_t *any,
+                         std::size_t count) {
+  for(auto idx = from; idx < size; ++idx) {
+    for(std::size_t str = 0; str < count; ++str) {
+      if(data[idx] == first[str] && (any[str] || (idx + 1 < size && data[idx + 1] == second[str]))) {
+        return idx;
+      }
+    }
+  }
+
+  return size;
 }
 
 
-std::vector<std::uint8_t> concat(const std::string &one, const std::vector<std::uint8_t> &two) {
-  std::vector<std::uint8_t> retVal(one.begin(), one.end());
-  retVal.insert(retVal.end(), two.begin(), two.end());
-  return retVal;
+#ifdef NYX_X86_DISPATCH
+__attribute__((target("sse2")))
+std::size_t filterSse2(const std::uint8_t *data, std::size_t size, std::size_t from,
+                       const std::uint8_t *first, const std::uint8_t *second, const std::uint8_t *any,
+                       std::size_t count) {
+  auto idx = from;
+
+  for(; idx + 17 <= size; idx += 16) {
+    auto one = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + idx));
+    auto two = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + idx + 1));
+    auto hit = _mm_setzero_si128();
+
+    for(std::size_t str = 0; str < count; ++str) {
+      auto lead = _mm_cmpeq_epi8(one, _mm_set1_epi8(static_cast<char>(first[str])));
+      auto next = _mm_or_si128(_mm_cmpeq_epi8(two, _mm_set1_epi8(static_cast<char>(second[str]))),
+                               _mm_set1_epi8(static_cast<char>(any[str])));
+      hit = _mm_or_si128(hit, _mm_and_si128(lead, next));
+    }
+
+    auto bits = static_cast<unsigned>(_mm_movemask_epi8(hit));
+    if(bits) {
+      return idx + __builtin_ctz(bits);
+    }
+  }
+
+  return filterScalar(data, size, idx, first, second, any, count);
+}
+
+
+__attribute__((target("avx2")))
+std::size_t filterAvx2(const std::uint8_t *data, std::size_t size, std::size_t from,
+                       const std::uint8_t *first, const std::uint8_t *second, const std::uint8_t *any,
+                       std::size_t count) {
+  auto idx = from;
+
+  for(; idx + 33 <= size; idx += 32) {
+    auto one = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + idx));
+    auto two = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + idx + 1));
+    auto hit = _mm256_setzero_si256();
+
+    for(std::size_t str = 0; str < count; ++str) {
+      auto lead = _mm256_cmpeq_epi8(one, _mm256_set1_epi8(static_cast<char>(first[str])));
+      auto next = _mm256_or_si256(_mm256_cmpeq_epi8(two, _mm256_set1_epi8(static_cast<char>(second[str]))),
+                                  _mm256_set1_epi8(static_cast<char>(any[str])));
+      hit = _mm256_or_si256(hit, _mm256_and_si256(lead, next));
+    }
+
+    auto bits = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+    if(bits) {
+      return idx + __builtin_ctz(bits);
+    }
+  }
+
+  return filterSse2(data, size, idx, first, second, any, count);
+}
+#endif
+
+
+filter selectFilter() {
+#ifdef NYX_X86_DISPATCH
+  __builtin_cpu_init();
+
+  if(__builtin_cpu_supports("avx2")) {
+    return filterAvx2;
+  }
+  else if(__builtin_cpu_supports("sse2")) {
+    return filterSse2;
+  }
+#endif
+
+  return filterScalar;
+}
+
+
+scanner selectScanner() {
+#ifdef NYX_X86_DISPATCH
+  __builtin_cpu_init();
+
+  if(__builtin_cpu_supports("avx2")) {
+    return scanAvx2;
+  }
+  else if(__builtin_cpu_supports("sse2")) {
+    return scanSse2;
+  }
+#endif
+
+  return scanScalar;
 }
 
 
-std::vector<std::uint8_t> concat(const std::vector<std::uint8_t> &one, const std::string &two) {
-  std::vector<std::uint8_t> retVal(one.begin(), one.end());
-  retVal.insert(retVal.end(), two.begin(), two.end());
-  return retVal;
+template<typename RAW>
+swapper selectSwapper() {
+#ifdef NYX_X86_DISPATCH
+  __builtin_cpu_init();
+
+  if(__builtin_cpu_supports("avx2")) {
+    return swapAvx2<RAW>;
+  }
+  else if(__builtin_cpu_supports("ssse3")) {
+    return swapSsse3<RAW>;
+  }
+#endif
+
+  return swapScalar<RAW>;
+}
+
+
+}
+
+
+void nyx::detail::swap16(std::uint8_t *dst, const std::uint8_t *src, std::size_t count) {
+  static const swapper impl = selectSwapper<std::uint16_t>();
+  impl(dst, src, count);
+}
+
+
+void nyx::detail::swap32(std::uint8_t *dst, const std::uint8_t *src, std::size_t count) {
+  static const swapper impl = selectSwapper<std::uint32_t>();
+  impl(dst, src, count);
 }
 
 
-std::vector<std::uint8_t> concat(const std::vector<std::uint8_t> &one,
-                                 const std::vector<std::uint8_t> &two) {
-  std::vector<std::uint8_t> retVal(one.begin(), one.end());
-  retVal.insert(retVal.end(), two.begin(), two.end());
-  return retVal;
+void nyx::detail::swap64(std::uint8_t *dst, const std::uint8_t *src, std::size_t count) {
+  static const swapper impl = selectSwapper<std::uint64_t>();
+  impl(dst, src, count);
 }
 
+
+std::size_t nyx::scan(const std::uint8_t *data, std::size_t size, std::uint8_t mask, std::uint8_t value) {
+  static const scanner impl = selectScanner();
+  return impl(data, size, mask, value);
+}
+
+
+nyx::prefixes::prefixes(const view *strings, std::size_t count):
+  strings(strings),
+  count(count),
+  first(count),
+  second(count),
+  any(count) {
+  for(std::size_t str = 0; str < count; ++str) {
+    first[str] = strings[str][0];
+    second[str] = strings[str].size() > 1 ? strings[str][1] : 0;
+    any[str] = strings[str].size() > 1 ? 0 : 0xFF;
+  }
+}
+
+
+std::size_t nyx::prefixes::find(const std::uint8_t *data, std::size_t size, std::size_t from,
+                                std::size_t &which) const {
+  static const filter impl = selectFilter();
+
+  for(auto idx = from; (idx = impl(data, size, idx, first.data(), second.data(), any.data(), count)) < size; ++idx) {
+    for(std::size_t str = 0; str < count; ++str) {
+      if(starts(data + idx, size - idx, str)) {
+        which = str;
+        return idx;
+      }
+    }
+  }
+
+  return size;
+}
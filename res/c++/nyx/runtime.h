@@ -1,8 +1,14 @@
 #pragma once
 
+#include <new>
 #include <string>
 #include <vector>
+#include <utility>
+#include <iterator>
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
 
 
 #ifndef NYX_BUILD_VERSION
@@ -18,18 +24,930 @@ namespace nyx {
 const std::uint32_t GEN_NYX_VERSION = NYX_GEN_VERSION_INT;
 
 
-std::vector<std::uint8_t> concat(const std::string &, const std::string &);
-std::vector<std::uint8_t> concat(const std::string &, const std::vector<std::uint8_t> &);
-std::vector<std::uint8_t> concat(const std::vector<std::uint8_t> &, const std::string &);
-std::vector<std::uint8_t> concat(const std::vector<std::uint8_t> &, const std::vector<std::uint8_t> &);
+enum class byte_order {
+  big,
+  little,
+  machine
+};
 
 
-template<typename LAMBDA>
-void sequence(const std::vector<std::uint8_t> &vec, LAMBDA lambda) {
-  for(std::size_t idx = 0, max = vec.size(); idx < max; ++idx) {
-    lambda(vec[idx], idx, max);
+namespace detail {
+
+
+constexpr std::uint8_t bswap(std::uint8_t val) {
+  return val;
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+constexpr std::uint16_t bswap(std::uint16_t val) {
+  return __builtin_bswap16(val);
+}
+
+constexpr std::uint32_t bswap(std::uint32_t val) {
+  return __builtin_bswap32(val);
+}
+
+constexpr std::uint64_t bswap(std::uint64_t val) {
+  return __builtin_bswap64(val);
+}
+#else
+constexpr std::uint16_t bswap(std::uint16_t val) {
+  return static_cast<std::uint16_t>((val << 8) | (val >> 8));
+}
+
+constexpr std::uint32_t bswap(std::uint32_t val) {
+  return ((val & 0x000000FFU) << 24) | ((val & 0x0000FF00U) <<  8) |
+         ((val & 0x00FF0000U) >>  8) | ((val & 0xFF000000U) >> 24);
+}
+
+constexpr std::uint64_t bswap(std::uint64_t val) {
+  return (static_cast<std::uint64_t>(bswap(static_cast<std::uint32_t>(val))) << 32) |
+         bswap(static_cast<std::uint32_t>(val >> 32));
+}
+#endif
+
+
+// true when values stored in the given order must be byte swapped on this host
+constexpr bool swapped(byte_order order) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  return order == byte_order::little;
+#else
+  return order == byte_order::big;
+#endif
+}
+
+
+// unsigned integer of the same width as a numeric field, what its bytes are
+// loaded into and swapped as
+template<std::size_t SIZE>
+struct word;
+
+template<>
+struct word<1> {
+  typedef std::uint8_t type;
+};
+
+template<>
+struct word<2> {
+  typedef std::uint16_t type;
+};
+
+template<>
+struct word<4> {
+  typedef std::uint32_t type;
+};
+
+template<>
+struct word<8> {
+  typedef std::uint64_t type;
+};
+
+
+// byte swap count values of the given width from src into dst; these pick a
+// vectorised kernel for the host at run time
+void swap16(std::uint8_t *dst, const std::uint8_t *src, std::size_t count);
+void swap32(std::uint8_t *dst, const std::uint8_t *src, std::size_t count);
+void swap64(std::uint8_t *dst, const std::uint8_t *src, std::size_t count);
+
+
+}
+
+
+// read a value of type T stored in the given byte order; src need not be
+// aligned, and the copies reduce to a single load plus a byte swap
+template<typename T, byte_order ORDER>
+T load(const std::uint8_t *src) {
+  typename detail::word<sizeof(T)>::type bits;
+  std::memcpy(&bits, src, sizeof(bits));
+
+  if(detail::swapped(ORDER)) {
+    bits = detail::bswap(bits);
+  }
+
+  T val;
+  std::memcpy(&val, &bits, sizeof(val));
+  return val;
+}
+
+
+// write a value of type T in the given byte order; the counterpart of load
+template<typename T, byte_order ORDER>
+void store(std::uint8_t *dst, T val) {
+  typename detail::word<sizeof(T)>::type bits;
+  std::memcpy(&bits, &val, sizeof(bits));
+
+  if(detail::swapped(ORDER)) {
+    bits = detail::bswap(bits);
+  }
+
+  std::memcpy(dst, &bits, sizeof(bits));
+}
+
+
+// decode count values of type T laid out back to back in the given byte order
+template<byte_order ORDER, typename T>
+void unpack(T *dst, const std::uint8_t *src, std::size_t count) {
+  auto out = reinterpret_cast<std::uint8_t *>(dst);
+
+  if(sizeof(T) == 1 || !detail::swapped(ORDER)) {
+    std::memcpy(out, src, count * sizeof(T));
+  }
+  else if(sizeof(T) == 2) {
+    detail::swap16(out, src, count);
+  }
+  else if(sizeof(T) == 4) {
+    detail::swap32(out, src, count);
+  }
+  else {
+    detail::swap64(out, src, count);
+  }
+}
+
+
+namespace detail {
+
+
+template<typename T>
+constexpr bool negative(T val, std::true_type) {
+  return val < 0;
+}
+
+template<typename T>
+constexpr bool negative(T, std::false_type) {
+  return false;
+}
+
+
+}
+
+
+// a repetition count read from the input as a std::size_t no larger than
+// limit; false when it is negative
+template<typename T>
+bool repeat_count(T val, std::size_t limit, std::size_t &count) {
+  if(detail::negative(val, std::is_signed<T>())) {
+    return false;
   }
+
+  count = static_cast<std::uint64_t>(val) > limit ? limit : static_cast<std::size_t>(val);
+  return true;
 }
 
+
+// decode a base 128 varint, least significant group first, of at most limit
+// bytes; returns the bytes used, 0 when the input ends before the value does
+// and -1 when no final byte falls within the limit
+inline std::ptrdiff_t varint(const std::uint8_t *src, std::size_t avail, std::size_t limit,
+                             std::uint64_t &out) {
+  std::size_t idx = 0;
+  out = 0;
+
+  if(avail >= 8) {
+    // the first eight bytes in one word: find the final byte from the clear
+    // continuation bits then squeeze the 7 bit groups together
+    std::uint64_t word;
+    std::memcpy(&word, src, sizeof(word));
+    if(detail::swapped(byte_order::little)) {
+      word = detail::bswap(word);
+    }
+
+    auto stops = ~word & 0x8080808080808080ULL;
+    std::size_t used = 8;
+    if(stops != 0) {
+#if defined(__GNUC__) || defined(__clang__)
+      used = __builtin_ctzll(stops) / 8 + 1;
+#else
+      for(used = 1; (stops & 0x80) == 0; stops >>= 8) {
+        ++used;
+      }
+#endif
+      if(used < 8) {
+        word &= (1ULL << (used * 8)) - 1;
+      }
+    }
+
+    if(used > limit) {
+      return -1;
+    }
+
+    word &= 0x7F7F7F7F7F7F7F7FULL;
+    word = ((word & 0x7F007F007F007F00ULL) >> 1) | (word & 0x007F007F007F007FULL);
+    word = ((word & 0x3FFF00003FFF0000ULL) >> 2) | (word & 0x00003FFF00003FFFULL);
+    word = ((word & 0x0FFFFFFF00000000ULL) >> 4) | (word & 0x000000000FFFFFFFULL);
+    out = word;
+
+    if(stops != 0) {
+      return used;
+    }
+
+    idx = 8;
+  }
+
+  for(; idx < avail && idx < limit; ++idx) {
+    if(idx < 10) {
+      out |= static_cast<std::uint64_t>(src[idx] & 0x7F) << (7 * idx);
+    }
+    if((src[idx] & 0x80) == 0) {
+      return idx + 1;
+    }
+  }
+
+  return idx < limit ? 0 : -1;
 }
 
+
+// vector with room for N elements inside itself, for repetitions bounded by a
+// small constant; it never allocates, so growing it past N is a bug
+template<typename T, std::size_t N>
+class inline_vector {
+  public:
+    typedef T        value_type;
+    typedef T       *iterator;
+    typedef const T *const_iterator;
+
+    inline_vector(): count(0) {
+    }
+
+    template<typename ITER>
+    inline_vector(ITER first, ITER last): count(0) {
+      assign(first, last);
+    }
+
+    inline_vector(const inline_vector &that): count(0) {
+      assign(that.begin(), that.end());
+    }
+
+    inline_vector(inline_vector &&that): count(0) {
+      for(auto &val : that) {
+        emplace_back(std::move(val));
+      }
+    }
+
+    ~inline_vector() {
+      clear();
+    }
+
+    inline_vector &operator=(const inline_vector &that) {
+      if(this != &that) {
+        assign(that.begin(), that.end());
+      }
+
+      return *this;
+    }
+
+    inline_vector &operator=(inline_vector &&that) {
+      if(this != &that) {
+        clear();
+        for(auto &val : that) {
+          emplace_back(std::move(val));
+        }
+      }
+
+      return *this;
+    }
+
+    static constexpr std::size_t capacity() {
+      return N;
+    }
+
+    std::size_t size() const {
+      return count;
+    }
+
+    bool empty() const {
+      return count == 0;
+    }
+
+    T *data() {
+      return reinterpret_cast<T *>(slots);
+    }
+
+    const T *data() const {
+      return reinterpret_cast<const T *>(slots);
+    }
+
+    iterator begin() {
+      return data();
+    }
+
+    iterator end() {
+      return data() + count;
+    }
+
+    const_iterator begin() const {
+      return data();
+    }
+
+    const_iterator end() const {
+      return data() + count;
+    }
+
+    T &operator[](std::size_t idx) {
+      return data()[idx];
+    }
+
+    const T &operator[](std::size_t idx) const {
+      return data()[idx];
+    }
+
+    T &back() {
+      return data()[count - 1];
+    }
+
+    const T &back() const {
+      return data()[count - 1];
+    }
+
+    // nothing to set aside, the room is always there
+    void reserve(std::size_t) {
+    }
+
+    template<typename... ARGS>
+    T &emplace_back(ARGS &&...args) {
+      new(&slots[count]) T(std::forward<ARGS>(args)...);
+      return data()[count++];
+    }
+
+    void push_back(const T &val) {
+      emplace_back(val);
+    }
+
+    void pop_back() {
+      data()[--count].~T();
+    }
+
+    void resize(std::size_t size) {
+      while(count > size) {
+        pop_back();
+      }
+      while(count < size) {
+        emplace_back();
+      }
+    }
+
+    void clear() {
+      resize(0);
+    }
+
+    template<typename ITER>
+    void assign(ITER first, ITER last) {
+      clear();
+      for(; first != last; ++first) {
+        emplace_back(*first);
+      }
+    }
+
+    void assign(const T *src, std::size_t size) {
+      assign(src, src + size);
+    }
+
+    void append(std::size_t size, const T &val) {
+      while(size-- > 0) {
+        emplace_back(val);
+      }
+    }
+
+  private:
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type slots[N];
+    std::size_t count;
+};
+
+
+// non-owning window onto a run of bytes, usually inside the buffer handed to
+// consume; it is only valid for as long as that buffer is
+class view {
+  public:
+    view(): ptr(nullptr), len(0) {
+    }
+
+    view(const std::uint8_t *data, std::size_t size): ptr(data), len(size) {
+    }
+
+    template<typename TRAITS, typename ALLOC>
+    view(const std::basic_string<char, TRAITS, ALLOC> &str):
+      ptr(reinterpret_cast<const std::uint8_t *>(str.data())),
+      len(str.size()) {
+    }
+
+    template<typename ALLOC>
+    view(const std::vector<std::uint8_t, ALLOC> &vec): ptr(vec.data()), len(vec.size()) {
+    }
+
+    template<typename T, std::size_t N>
+    view(const inline_vector<T, N> &vec):
+      ptr(reinterpret_cast<const std::uint8_t *>(vec.data())),
+      len(vec.size() * sizeof(T)) {
+      static_assert(sizeof(T) == 1, "views are of bytes");
+    }
+
+    const std::uint8_t *data() const {
+      return ptr;
+    }
+
+    std::size_t size() const {
+      return len;
+    }
+
+    bool empty() const {
+      return len == 0;
+    }
+
+    const std::uint8_t *begin() const {
+      return ptr;
+    }
+
+    const std::uint8_t *end() const {
+      return ptr + len;
+    }
+
+    const std::uint8_t &operator[](std::size_t idx) const {
+      return ptr[idx];
+    }
+
+    void clear() {
+      ptr = nullptr;
+      len = 0;
+    }
+
+  private:
+    const std::uint8_t *ptr;
+    std::size_t         len;
+};
+
+
+template<std::size_t N>
+class chain;
+
+
+namespace detail {
+
+
+template<typename T>
+struct width {
+  static constexpr std::size_t value = 1;
+};
+
+template<std::size_t N>
+struct width<chain<N>> {
+  static constexpr std::size_t value = N;
+};
+
+template<typename... PARTS>
+struct widths;
+
+template<>
+struct widths<> {
+  static constexpr std::size_t value = 0;
+};
+
+template<typename HEAD, typename... REST>
+struct widths<HEAD, REST...> {
+  static constexpr std::size_t value = width<HEAD>::value + widths<REST...>::value;
+};
+
+
+}
+
+
+// runs of bytes read one after the other as if they were a single run, without
+// copying them together; like view it only refers to them
+template<std::size_t N>
+class chain {
+  public:
+    class iterator {
+      public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef std::uint8_t              value_type;
+        typedef std::ptrdiff_t            difference_type;
+        typedef const std::uint8_t       *pointer;
+        typedef const std::uint8_t       &reference;
+
+        iterator(const view *part, const view *last, std::size_t pos): part(part), last(last), pos(pos) {
+          skip();
+        }
+
+        reference operator*() const {
+          return (*part)[pos];
+        }
+
+        iterator &operator++() {
+          ++pos;
+          skip();
+          return *this;
+        }
+
+        iterator operator++(int) {
+          auto prev = *this;
+          ++*this;
+          return prev;
+        }
+
+        bool operator==(const iterator &that) const {
+          return part == that.part && pos == that.pos;
+        }
+
+        bool operator!=(const iterator &that) const {
+          return !(*this == that);
+        }
+
+      private:
+        void skip() {
+          while(part != last && pos == part->size()) {
+            ++part;
+            pos = 0;
+          }
+        }
+
+        const view  *part;
+        const view  *last;
+        std::size_t  pos;
+    };
+
+    chain(): used(0) {
+    }
+
+    void add(const view &part) {
+      parts[used++] = part;
+    }
+
+    template<std::size_t M>
+    void add(const chain<M> &that) {
+      for(std::size_t idx = 0; idx < M; ++idx) {
+        parts[used++] = that.part(idx);
+      }
+    }
+
+    const view &part(std::size_t idx) const {
+      return parts[idx];
+    }
+
+    std::size_t size() const {
+      std::size_t total = 0;
+      for(std::size_t idx = 0; idx < N; ++idx) {
+        total += parts[idx].size();
+      }
+      return total;
+    }
+
+    bool empty() const {
+      return size() == 0;
+    }
+
+    const std::uint8_t &operator[](std::size_t idx) const {
+      auto part = parts;
+      for(; idx >= part->size(); ++part) {
+        idx -= part->size();
+      }
+      return (*part)[idx];
+    }
+
+    iterator begin() const {
+      return iterator(parts, parts + N, 0);
+    }
+
+    iterator end() const {
+      return iterator(parts + N, parts + N, 0);
+    }
+
+    // copies the bytes out, for when the result is kept
+    template<typename ALLOC>
+    operator std::vector<std::uint8_t, ALLOC>() const {
+      std::vector<std::uint8_t, ALLOC> bytes;
+      bytes.reserve(size());
+      for(std::size_t idx = 0; idx < N; ++idx) {
+        bytes.insert(bytes.end(), parts[idx].begin(), parts[idx].end());
+      }
+      return bytes;
+    }
+
+  private:
+    view        parts[N];
+    std::size_t used;
+};
+
+
+// a sub-rule that is only decoded the first time it is looked at; like view it
+// refers to the consumed buffer, which must outlive it, and it is not safe to
+// first touch from several threads at once
+template<typename T>
+class lazy {
+  public:
+    lazy(): ptr(nullptr), len(0), state(pending) {
+    }
+
+    lazy(const std::uint8_t *data, std::size_t size): ptr(data), len(size), state(pending) {
+    }
+
+    const T &get() const {
+      if(state == pending) {
+        state = value.consume(ptr, len) == static_cast<std::ptrdiff_t>(len) ? decoded : failed;
+      }
+
+      return value;
+    }
+
+    const T &operator*() const {
+      return get();
+    }
+
+    const T *operator->() const {
+      return &get();
+    }
+
+    // false when the recorded bytes do not decode, validation included
+    bool valid() const {
+      get();
+      return state == decoded;
+    }
+
+    // the bytes the member covers, without decoding them
+    view bytes() const {
+      return view(ptr, len);
+    }
+
+    // record other bytes, keeping what the value has allocated
+    void assign(const std::uint8_t *data, std::size_t size) {
+      ptr = data;
+      len = size;
+      state = pending;
+    }
+
+    // forget the bytes, the value is reset() rather than destroyed
+    void reset() {
+      assign(nullptr, 0);
+      value.reset();
+    }
+
+  private:
+    enum state_type {
+      pending,
+      decoded,
+      failed
+    };
+
+    const std::uint8_t *ptr;
+    std::size_t         len;
+    mutable T           value;
+    mutable state_type  state;
+};
+
+
+namespace detail {
+
+
+// position of T among TYPES
+template<typename T, typename... TYPES>
+struct position;
+
+template<typename T, typename... REST>
+struct position<T, T, REST...> {
+  static constexpr std::size_t value = 0;
+};
+
+template<typename T, typename HEAD, typename... REST>
+struct position<T, HEAD, REST...> {
+  static constexpr std::size_t value = 1 + position<T, REST...>::value;
+};
+
+
+template<typename T>
+void destroy(void *obj) {
+  static_cast<T *>(obj)->~T();
+}
+
+template<typename T>
+void duplicate(void *dst, const void *src) {
+  new(dst) T(*static_cast<const T *>(src));
+}
+
+template<typename T>
+void transfer(void *dst, void *src) {
+  new(dst) T(std::move(*static_cast<T *>(src)));
+}
+
+
+}
+
+
+// holds at most one of TYPES in place, the storage of a @match; it is as big
+// as the largest of them plus tags saying which one, if any, is present and
+// which one is constructed, as park() can keep an object around for reuse
+template<typename... TYPES>
+class choice {
+  public:
+    static_assert(sizeof...(TYPES) < 128, "too many choices");
+
+    choice(): tag(-1), held(-1) {
+    }
+
+    choice(const choice &that): tag(-1), held(-1) {
+      if(that.tag >= 0) {
+        copies[that.tag](&data, &that.data);
+        tag = held = that.tag;
+      }
+    }
+
+    choice(choice &&that): tag(-1), held(-1) {
+      if(that.tag >= 0) {
+        moves[that.tag](&data, &that.data);
+        tag = held = that.tag;
+      }
+    }
+
+    ~choice() {
+      clear();
+    }
+
+    choice &operator=(const choice &that) {
+      if(this != &that) {
+        clear();
+        if(that.tag >= 0) {
+          copies[that.tag](&data, &that.data);
+          tag = held = that.tag;
+        }
+      }
+
+      return *this;
+    }
+
+    choice &operator=(choice &&that) {
+      if(this != &that) {
+        clear();
+        if(that.tag >= 0) {
+          moves[that.tag](&data, &that.data);
+          tag = held = that.tag;
+        }
+      }
+
+      return *this;
+    }
+
+    // which of TYPES is held, -1 when none is
+    std::ptrdiff_t index() const {
+      return tag;
+    }
+
+    bool empty() const {
+      return tag < 0;
+    }
+
+    template<typename T>
+    bool is() const {
+      return tag == static_cast<std::ptrdiff_t>(detail::position<T, TYPES...>::value);
+    }
+
+    // the held T; only valid when is<T>()
+    template<typename T>
+    T &get() {
+      return *reinterpret_cast<T *>(&data);
+    }
+
+    template<typename T>
+    const T &get() const {
+      return *reinterpret_cast<const T *>(&data);
+    }
+
+    // replace whatever is held with a default constructed T
+    template<typename T>
+    T &emplace() {
+      clear();
+      new(&data) T();
+      tag = held = static_cast<signed char>(detail::position<T, TYPES...>::value);
+      return get<T>();
+    }
+
+    // hold a T again, reusing a parked one after a reset() when there is one
+    template<typename T>
+    T &reuse() {
+      if(held != static_cast<signed char>(detail::position<T, TYPES...>::value)) {
+        return emplace<T>();
+      }
+
+      tag = held;
+      get<T>().reset();
+      return get<T>();
+    }
+
+    void clear() {
+      if(held >= 0) {
+        destroys[held](&data);
+        tag = held = -1;
+      }
+    }
+
+    // empty as far as readers can tell, but the object stays constructed for
+    // reuse<T>() to pick up
+    void park() {
+      tag = -1;
+    }
+
+  private:
+    typedef void (*destroy_type)(void *);
+    typedef void (*copy_type)(void *, const void *);
+    typedef void (*move_type)(void *, void *);
+
+    static constexpr destroy_type destroys[] = { &detail::destroy<TYPES>... };
+    static constexpr copy_type    copies[]   = { &detail::duplicate<TYPES>... };
+    static constexpr move_type    moves[]    = { &detail::transfer<TYPES>... };
+
+    typename std::aligned_storage<std::max({ sizeof(TYPES)... }),
+                                  std::max({ alignof(TYPES)... })>::type data;
+    signed char tag;
+    signed char held;
+};
+
+template<typename... TYPES>
+constexpr typename choice<TYPES...>::destroy_type choice<TYPES...>::destroys[];
+
+template<typename... TYPES>
+constexpr typename choice<TYPES...>::copy_type choice<TYPES...>::copies[];
+
+template<typename... TYPES>
+constexpr typename choice<TYPES...>::move_type choice<TYPES...>::moves[];
+
+
+// anything a view can be made from, and other chains, joined end to end
+template<typename... PARTS>
+chain<detail::widths<PARTS...>::value> concat(const PARTS &... parts) {
+  chain<detail::widths<PARTS...>::value> joined;
+  int expand[] = { (joined.add(parts), 0)... };
+  (void) expand;
+  return joined;
+}
+
+
+// adds a byte, or a run of them, to the end of a string or vector
+template<typename BYTES>
+void append(BYTES &bytes, std::uint8_t byte) {
+  bytes.push_back(static_cast<typename BYTES::value_type>(byte));
+}
+
+template<typename BYTES>
+void append(BYTES &bytes, const view &part) {
+  bytes.insert(bytes.end(), part.begin(), part.end());
+}
+
+template<typename BYTES, std::size_t N>
+void append(BYTES &bytes, const chain<N> &parts) {
+  for(std::size_t idx = 0; idx < N; ++idx) {
+    append(bytes, parts.part(idx));
+  }
+}
+
+
+// length of the leading run of bytes for which (byte & mask) == value; picks a
+// vectorised kernel for the host at run time
+std::size_t scan(const std::uint8_t *data, std::size_t size, std::uint8_t mask, std::uint8_t value);
+
+
+// byte strings looked for together, such as the fixed bytes rules start with;
+// candidates are picked out a block of input at a time by the first two bytes
+// of every string, and only those are compared in full
+class prefixes {
+  public:
+    prefixes(const view *strings, std::size_t count);
+
+    // offset of the first place at or after from where one of the strings
+    // starts, setting which to the lowest such string, or size when none does
+    std::size_t find(const std::uint8_t *data, std::size_t size, std::size_t from, std::size_t &which) const;
+
+    // whether the string which starts at data
+    bool starts(const std::uint8_t *data, std::size_t size, std::size_t which) const {
+      auto &str = strings[which];
+      return str.size() <= size && std::memcmp(data, str.data(), str.size()) == 0;
+    }
+
+  private:
+    const view                *strings;
+    std::size_t                count;
+    std::vector<std::uint8_t>  first;
+    std::vector<std::uint8_t>  second;
+    std::vector<std::uint8_t>  any;
+};
+
+
+template<typename BYTES, typename LAMBDA>
+void sequence(const BYTES &bytes, LAMBDA lambda) {
+  for(std::size_t idx = 0, max = bytes.size(); idx < max; ++idx) {
+    lambda(bytes[idx], idx, max);
+  }
+}
+
+template<typename LAMBDA>
+void sequence(const std::uint8_t *first, const std::uint8_t *last, LAMBDA lambda) {
+  sequence(view(first, last - first), lambda);
+}
+
+template<std::size_t N, typename LAMBDA>
+void sequence(const chain<N> &parts, LAMBDA lambda) {
+  std::size_t idx = 0;
+  const auto max = parts.size();
+
+  for(std::size_t part = 0; part < N; ++part) {
+    for(auto byte : parts.part(part)) {
+      lambda(byte, idx++, max);
+    }
+  }
+}
+
+}
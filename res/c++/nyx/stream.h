@@ -0,0 +1,124 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+
+namespace nyx {
+
+
+// records how many more bytes a consume would have needed; true when short
+inline bool starved(std::size_t &need, std::size_t avail, std::size_t bytes) {
+  if(avail < bytes) {
+    need = std::max(need, bytes - avail);
+    return true;
+  }
+
+  return false;
+}
+
+
+// picks up the shortfall reported by a nested consume
+inline void carry(std::size_t &need, std::ptrdiff_t result) {
+  if(result < -1) {
+    need = std::max(need, static_cast<std::size_t>(-1 - result));
+  }
+}
+
+
+// consume result for a failed match, below -1 when more input could help
+inline std::ptrdiff_t failure(std::size_t need) {
+  return -1 - static_cast<std::ptrdiff_t>(need);
+}
+
+
+// additional bytes that would let a failed consume make progress, 0 if none
+inline std::size_t shortfall(std::ptrdiff_t result) {
+  return result < -1 ? static_cast<std::size_t>(-1 - result) : 0;
+}
+
+
+// position of a resumable decode within the stages of a rule
+struct cursor {
+  cursor(): stage(0), rep(0) {
+  }
+
+  int stage;
+  int rep;
+};
+
+
+// outcome of handing a block of input to a resumable decode
+struct status {
+  enum state_type {
+    done,
+    more,
+    failed
+  };
+
+  static status complete(std::size_t used) {
+    return status{ done, used, 0 };
+  }
+
+  static status starved(std::size_t used, std::size_t need) {
+    return status{ more, used, need };
+  }
+
+  static status failure(std::size_t used) {
+    return status{ failed, used, 0 };
+  }
+
+  state_type  state;
+  std::size_t used; // input bytes fully decoded, these need not be offered again
+  std::size_t need; // fewest additional bytes that could let the decode progress
+};
+
+
+// feeds input arriving in arbitrary pieces to a rule's resume function, only
+// holding on to the bytes of the element that is currently incomplete
+template<typename RULE>
+class stream {
+  public:
+    explicit stream(RULE &rule): target(rule), wanted(0) {
+    }
+
+    status feed(const std::uint8_t *data, std::size_t size) {
+      pending.insert(pending.end(), data, data + size);
+
+      if(pending.size() < wanted) {
+        return status::starved(0, wanted - pending.size());
+      }
+
+      return pump(false);
+    }
+
+    // no more input will arrive, anything incomplete is now an error
+    status finish() {
+      return pump(true);
+    }
+
+    // bytes received after the rule completed
+    const std::vector<std::uint8_t> &remaining() const {
+      return pending;
+    }
+
+  private:
+    status pump(bool last) {
+      auto result = target.resume(pos, pending.data(), pending.size(), last);
+
+      pending.erase(pending.begin(), pending.begin() + result.used);
+      wanted = result.state == status::more ? pending.size() + result.need : 0;
+
+      return result;
+    }
+
+    RULE                      &target;
+    cursor                     pos;
+    std::size_t                wanted;
+    std::vector<std::uint8_t>  pending;
+};
+
+
+}
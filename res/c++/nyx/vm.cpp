@@ -0,0 +1,216 @@
+#include "nyx/vm.h"
+
+#include <limits>
+#include <cstring>
+#include <algorithm>
+
+
+namespace {
+
+
+using nyx::byte_order;
+namespace vm = nyx::vm;
+
+
+std::size_t width(vm::number type) {
+  static const std::uint8_t sizes[] = { 1, 1, 2, 2, 4, 4, 8, 8, 4, 8 };
+  return sizes[type];
+}
+
+
+template<typename T>
+T fetch(const std::uint8_t *src, byte_order order) {
+  return order == byte_order::big    ? nyx::load<T, byte_order::big>(src) :
+         order == byte_order::little ? nyx::load<T, byte_order::little>(src) :
+                                       nyx::load<T, byte_order::machine>(src);
+}
+
+
+template<typename T>
+void fill(std::vector<T> &dst, const std::uint8_t *src, std::size_t count, byte_order order) {
+  dst.resize(count);
+
+  if(order == byte_order::big) {
+    nyx::unpack<byte_order::big>(dst.data(), src, count);
+  }
+  else if(order == byte_order::little) {
+    nyx::unpack<byte_order::little>(dst.data(), src, count);
+  }
+  else {
+    nyx::unpack<byte_order::machine>(dst.data(), src, count);
+  }
+}
+
+
+template<typename T>
+void assign(const vm::op &op, void *slot, const std::uint8_t *src, std::size_t count) {
+  if(op.into == vm::scalar) {
+    *static_cast<T *>(slot) = fetch<T>(src, op.order);
+  }
+  else {
+    fill(*static_cast<std::vector<T> *>(slot), src, count, op.order);
+  }
+}
+
+
+// the value of a count slot, negative counts allow no repetitions
+std::size_t bound(void *slot, vm::number type) {
+  std::int64_t val = 0;
+
+  switch(type) {
+    case vm::u8:  val = *static_cast<const std::uint8_t *>(slot);  break;
+    case vm::i8:  val = *static_cast<const std::int8_t *>(slot);   break;
+    case vm::u16: val = *static_cast<const std::uint16_t *>(slot); break;
+    case vm::i16: val = *static_cast<const std::int16_t *>(slot);  break;
+    case vm::u32: val = *static_cast<const std::uint32_t *>(slot); break;
+    case vm::i32: val = *static_cast<const std::int32_t *>(slot);  break;
+    case vm::u64: val = static_cast<std::int64_t>(
+                          std::min<std::uint64_t>(*static_cast<const std::uint64_t *>(slot),
+                                                  std::numeric_limits<std::int64_t>::max()));
+                  break;
+    case vm::i64: val = *static_cast<const std::int64_t *>(slot);  break;
+    case vm::f32: val = static_cast<std::int64_t>(*static_cast<const float *>(slot));  break;
+    case vm::f64: val = static_cast<std::int64_t>(*static_cast<const double *>(slot)); break;
+  }
+
+  return val < 0 ? 0 : static_cast<std::size_t>(val);
+}
+
+
+std::size_t lower(const vm::op &op, void *const *slots) {
+  return op.minimum == vm::counted ? bound(slots[op.count], op.width) : static_cast<std::size_t>(op.minimum);
+}
+
+
+std::size_t upper(const vm::op &op, void *const *slots) {
+  if(op.maximum == vm::counted) {
+    return bound(slots[op.count], op.width);
+  }
+  else if(op.maximum == vm::unbounded) {
+    return std::numeric_limits<std::size_t>::max();
+  }
+
+  return static_cast<std::size_t>(op.maximum);
+}
+
+
+}
+
+
+std::ptrdiff_t nyx::vm::run(const op *code, void *const *slots, const std::uint8_t *raw,
+                            std::size_t max) {
+  std::size_t idx = 0;
+  std::size_t rep;
+  std::size_t limit;
+  const op *pc = code;
+
+#if defined(__GNUC__) || defined(__clang__)
+  // one indirect jump per op, from the end of the previous one
+  static void *const labels[] = { &&op_halt, &&op_exact, &&op_pattern, &&op_numeric, &&op_rule };
+#  define NYX_VM_DISPATCH()  goto *labels[pc->code]
+#  define NYX_VM_CASE(name)  op_##name
+
+  NYX_VM_DISPATCH();
+#else
+#  define NYX_VM_DISPATCH()  goto dispatch
+#  define NYX_VM_CASE(name)  case name
+
+  dispatch:
+  switch(pc->code) {
+#endif
+
+  NYX_VM_CASE(exact):
+    limit = upper(*pc, slots);
+    for(rep = 0; rep < limit; ++rep) {
+      if(max - idx < pc->size || std::memcmp(&raw[idx], pc->bytes, pc->size) != 0) {
+        break;
+      }
+      idx += pc->size;
+    }
+    if(rep < lower(*pc, slots)) {
+      return -1;
+    }
+    ++pc;
+    NYX_VM_DISPATCH();
+
+  NYX_VM_CASE(pattern):
+    rep = nyx::scan(&raw[idx], std::min(max - idx, upper(*pc, slots)), pc->mask, pc->value);
+    if(rep < lower(*pc, slots)) {
+      return -1;
+    }
+    if(pc->into == scalar && rep > 0) {
+      *static_cast<std::uint8_t *>(slots[pc->slot]) = raw[idx];
+    }
+    else if(pc->into == string) {
+      static_cast<std::string *>(slots[pc->slot])->assign(reinterpret_cast<const char *>(&raw[idx]), rep);
+    }
+    else if(pc->into == view) {
+      *static_cast<nyx::view *>(slots[pc->slot]) = nyx::view(&raw[idx], rep);
+    }
+    idx += rep;
+    ++pc;
+    NYX_VM_DISPATCH();
+
+  NYX_VM_CASE(numeric):
+    rep = std::min((max - idx) / width(pc->type), upper(*pc, slots));
+    if(rep < lower(*pc, slots)) {
+      return -1;
+    }
+    if(pc->into == view) {
+      *static_cast<nyx::view *>(slots[pc->slot]) = nyx::view(&raw[idx], rep);
+    }
+    else if(pc->into == scalar && rep == 0) {
+      // an optional value that is not there reads as zero, as it does natively
+      std::memset(slots[pc->slot], 0, width(pc->type));
+    }
+    else if(pc->into != none) {
+      auto slot = slots[pc->slot];
+      auto src = &raw[idx];
+
+      switch(pc->type) {
+        case u8:  assign<std::uint8_t>(*pc, slot, src, rep);  break;
+        case i8:  assign<std::int8_t>(*pc, slot, src, rep);   break;
+        case u16: assign<std::uint16_t>(*pc, slot, src, rep); break;
+        case i16: assign<std::int16_t>(*pc, slot, src, rep);  break;
+        case u32: assign<std::uint32_t>(*pc, slot, src, rep); break;
+        case i32: assign<std::int32_t>(*pc, slot, src, rep);  break;
+        case u64: assign<std::uint64_t>(*pc, slot, src, rep); break;
+        case i64: assign<std::int64_t>(*pc, slot, src, rep);  break;
+        case f32: assign<float>(*pc, slot, src, rep);         break;
+        case f64: assign<double>(*pc, slot, src, rep);        break;
+      }
+    }
+    idx += rep * width(pc->type);
+    ++pc;
+    NYX_VM_DISPATCH();
+
+  NYX_VM_CASE(rule):
+    if(pc->clear != nullptr) {
+      pc->clear(slots[pc->slot]);
+    }
+    limit = upper(*pc, slots);
+    for(rep = 0; rep < limit; ++rep) {
+      auto result = pc->call(pc->slot < 0 ? nullptr : slots[pc->slot], &raw[idx], max - idx);
+      if(result < 0) {
+        break;
+      }
+      idx += result;
+    }
+    if(rep < lower(*pc, slots)) {
+      return -1;
+    }
+    ++pc;
+    NYX_VM_DISPATCH();
+
+  NYX_VM_CASE(halt):
+    return idx;
+
+#if !(defined(__GNUC__) || defined(__clang__))
+  }
+
+  return -1;
+#endif
+
+#undef NYX_VM_DISPATCH
+#undef NYX_VM_CASE
+}
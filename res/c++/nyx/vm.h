@@ -0,0 +1,122 @@
+#pragma once
+
+#include "nyx/runtime.h"
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace nyx {
+  namespace vm {
+
+
+    enum opcode : std::uint8_t {
+      halt,
+      exact,
+      pattern,
+      numeric,
+      rule
+    };
+
+
+    // the type a numeric stage reads, or that a repeat count is held in
+    enum number : std::uint8_t {
+      u8,
+      i8,
+      u16,
+      i16,
+      u32,
+      i32,
+      u64,
+      i64,
+      f32,
+      f64
+    };
+
+
+    // what a stage leaves its value in
+    enum target : std::uint8_t {
+      none,
+      scalar,
+      string,
+      vector,
+      view
+    };
+
+
+    // repeat bound read from the count slot rather than the op
+    const std::int64_t counted = -2;
+
+    // repeat bound for as many as match
+    const std::int64_t unbounded = -1;
+
+
+    // calls into a sub-rule's consume for the element about to be decoded
+    typedef std::ptrdiff_t (*thunk)(void *, const std::uint8_t *, std::size_t);
+
+    // empties what a sub-rule's elements are kept in before any is decoded
+    typedef void (*empty)(void *);
+
+
+    // one stage of a rule, repeated between minimum and maximum times
+    struct op {
+      opcode               code;
+      number               type;     // numeric: what is read
+      byte_order           order;    // numeric: how it is stored
+      target               into;
+      std::uint8_t         mask;     // pattern: bits that are tested
+      std::uint8_t         value;    // pattern: what they must be
+      std::int16_t         slot;     // where the value goes, -1 for nowhere
+      std::int16_t         count;    // slot holding a counted bound
+      number               width;    // type of the count slot
+      std::int64_t         minimum;
+      std::int64_t         maximum;
+      const std::uint8_t  *bytes;    // exact: the literal
+      std::uint32_t        size;     // exact: its length
+      thunk                call;     // rule: how to decode an element
+      empty                clear;    // rule: how to start over, may be null
+    };
+
+
+    // runs the ops up to halt over the input, storing values through slots;
+    // returns the bytes matched or -1 when the input does not match
+    std::ptrdiff_t run(const op *code, void *const *slots, const std::uint8_t *raw, std::size_t max);
+
+
+    template<typename T>
+    std::ptrdiff_t consume(void *slot, const std::uint8_t *raw, std::size_t max) {
+      return static_cast<T *>(slot)->consume(raw, max);
+    }
+
+
+    template<typename T>
+    std::ptrdiff_t append(void *slot, const std::uint8_t *raw, std::size_t max) {
+      auto &vec = *static_cast<std::vector<T> *>(slot);
+
+      vec.emplace_back();
+      auto result = vec.back().consume(raw, max);
+      if(result < 0) {
+        vec.pop_back();
+      }
+
+      return result;
+    }
+
+
+    template<typename T>
+    void clear(void *slot) {
+      static_cast<std::vector<T> *>(slot)->clear();
+    }
+
+
+    template<typename T>
+    std::ptrdiff_t discard(void *, const std::uint8_t *raw, std::size_t max) {
+      T tmp;
+      return tmp.consume(raw, max);
+    }
+
+
+  }
+}
@@ -0,0 +1,79 @@
+#include "nyx/workers.h"
+
+
+nyx::workers::workers(std::size_t threads):
+  job(nullptr), total(0), next(0), busy(0), round(0), stopping(false) {
+  for(std::size_t idx = 1; idx < threads; ++idx) {
+    pool.emplace_back(&workers::work, this);
+  }
+}
+
+
+nyx::workers::~workers() {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stopping = true;
+  }
+  wake.notify_all();
+
+  for(auto &thread : pool) {
+    thread.join();
+  }
+}
+
+
+void nyx::workers::run(std::size_t count, const std::function<void(std::size_t)> &fn) {
+  std::lock_guard<std::mutex> serial(entry);
+
+  if(pool.empty() || count < 2) {
+    for(std::size_t idx = 0; idx < count; ++idx) {
+      fn(idx);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    job = &fn;
+    total = count;
+    next = 0;
+    busy = pool.size();
+    ++round;
+  }
+  wake.notify_all();
+
+  drain();
+
+  std::unique_lock<std::mutex> guard(lock);
+  idle.wait(guard, [this] { return busy == 0; });
+  job = nullptr;
+}
+
+
+void nyx::workers::drain() {
+  for(std::size_t idx; (idx = next.fetch_add(1)) < total;) {
+    (*job)(idx);
+  }
+}
+
+
+void nyx::workers::work() {
+  std::uint64_t seen = 0;
+
+  std::unique_lock<std::mutex> guard(lock);
+  for(;;) {
+    wake.wait(guard, [this, &seen] { return stopping || round != seen; });
+    if(stopping) {
+      return;
+    }
+    seen = round;
+
+    guard.unlock();
+    drain();
+    guard.lock();
+
+    if(--busy == 0) {
+      idle.notify_one();
+    }
+  }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <condition_variable>
+
+
+namespace nyx {
+
+
+// fixed set of threads that parallel consume overloads hand their elements to;
+// the calling thread works alongside them until the whole batch is done
+class workers {
+  public:
+    // threads counts the caller, so one means everything runs inline
+    explicit workers(std::size_t threads = std::thread::hardware_concurrency());
+    ~workers();
+
+    workers(const workers &) = delete;
+    workers &operator=(const workers &) = delete;
+
+    std::size_t size() const {
+      return pool.size() + 1;
+    }
+
+    // calls fn(idx) for every idx below count and returns once all have run;
+    // batches from different threads take turns, and fn must not start one
+    template<typename FN>
+    void parallel_for(std::size_t count, FN fn) {
+      run(count, std::function<void(std::size_t)>(fn));
+    }
+
+  private:
+    void run(std::size_t count, const std::function<void(std::size_t)> &fn);
+    void drain();
+    void work();
+
+    std::mutex                               entry;
+    std::mutex                               lock;
+    std::condition_variable                  wake;
+    std::condition_variable                  idle;
+    std::vector<std::thread>                 pool;
+    const std::function<void(std::size_t)>  *job;
+    std::size_t                              total;
+    std::atomic<std::size_t>                 next;
+    std::size_t                              busy;
+    std::uint64_t                            round;
+    bool                                     stopping;
+};
+
+
+}
@@ -1,4 +1,93 @@
 -- nyx C++ plugin
+--
+-- Options, passed to nyx with -O:
+--   views    store byte runs (pattern runs, u8 arrays) as nyx::view into the
+--            consumed buffer instead of copying them into a string or vector
+--   arena    allocate the strings and vectors of decoded rules from the
+--            nyx::arena made current with nyx::arena::scope (see nyx/arena.h)
+--   lazy[=rule.member,...]
+--            store the listed sub-rule members, or all of them, as nyx::lazy
+--            which records the bytes during consume and decodes them on first
+--            use; members used in counts, @match or code are never lazy,
+--            nor are members of rules that validate, themselves or through
+--            the rules they hold, or members whose type @match chooses, which
+--            are decoded in full
+--   parallel also generate a consume overload taking a nyx::workers pool (see
+--            nyx/workers.h), which finds the elements of sub-rule
+--            repetitions with skip() and decodes them on the pool
+--   bytecode[=rule,...]
+--            run the stages of the listed rules, or all of them, through the
+--            nyx::vm interpreter (see nyx/vm.h) from a table of ops instead
+--            of unrolled code; rules with stages it cannot express, such as
+--            @match, stay native
+--   header-only
+--            define every rule's functions inline in its namespace header
+--            and write no .cpp, so calls into nested rules can be inlined
+--   instrument
+--            count, per rule, which alternates and @match cases consume
+--            takes and how often it fails (see nyx/profile.h); a saved
+--            profile handed back with nyx --profile FILE puts the hot
+--            branches first wherever that cannot change what matches
+--   twopass  count the elements of unbounded sub-rule repetitions with skip()
+--            before decoding them, so their vector is allocated exactly once
+--   streaming
+--            also generate resume(), which decodes input handed over in
+--            pieces (see nyx/stream.h); consume results below -1 then report
+--            how many more bytes the input was short by
+--   columnar=rule,...
+--            also generate rule_batch for the listed rules, which holds
+--            decoded records column by column: an array per member, with
+--            strings and vectors packed back to back and located by offsets;
+--            other rules collect repetitions of a listed rule into its batch
+--            instead of a vector of records
+--   recycle  keep what decoded objects hold for the next decode: vectors of
+--            sub-rules become nyx::reuse_vector, whose elements survive
+--            clear(), and @match keeps its last case parked, so reset() and
+--            consume reuse capacity all the way down (see nyx/pool.h, which
+--            also has a per thread object_pool); without it reset() still
+--            empties an object, but vectors of sub-rules and @match destroy
+--            the elements they held, and object_pool will not compile
+--   scanner=rule,...
+--            also generate seek() for the listed rules, which finds the next
+--            place in a larger input one of them decodes at: the fixed bytes
+--            the rule starts with are searched for a block at a time (see
+--            nyx::prefixes) and each place they occur is tried with consume;
+--            a seek() for the namespace looks for all of its listed rules at
+--            once
+--   layout   lay out the members of generated classes widest alignment first
+--            to keep padding down, and generate a static layout() that writes
+--            the sizeof of the class next to what it would be with the members
+--            in storage order
+
+Options = {}
+Lazy = {}
+Bytecode = {}
+Columnar = {}
+Scanner = {}
+Rules = {}
+Inline = ''
+Profile = {}
+Counters = nil
+
+
+-- stands in for the implementation file when everything goes in the header,
+-- holding the definitions until the rule classes have all been written
+function buffer()
+  local parts = {}
+
+  return {
+    write = function(self, ...)
+      for _, val in ipairs({ ... }) do
+        parts[#parts + 1] = tostring(val)
+      end
+    end,
+    text = function(self)
+      return table.concat(parts)
+    end,
+    close = function(self)
+    end
+  }
+end
 
 function createNamespace(ns, root)
   local dir = root .. table.concat(table.slice(ns, 1, #ns - 1), '/')
@@ -15,6 +104,12 @@ function createNamespace(ns, root)
     return nil, nil
   end
 
+  header:write("#pragma once\n\n")
+
+  if Options['header-only'] then
+    return header, buffer()
+  end
+
   local code = io.open(filebase .. '.cpp', "w")
   if code == nil then
     io.write("Faliure to create namespace implementation: '", filebase, ".cpp'\n")
@@ -22,7 +117,6 @@ function createNamespace(ns, root)
     return nil, nil
   end
 
-  header:write("#pragma once\n\n")
   code:write("#include \"", table.concat(ns, '/'), ".h\"\n",
              "\n\n",
              "using namespace ", table.concat(ns, '::'), ";\n")
@@ -41,11 +135,35 @@ function includeImports(header, imports)
     end
   end
 
-  header:write("#include \"nyx/runtime.h\"\n\n",
+  header:write("#include \"nyx/runtime.h\"\n")
+  if Options.arena then
+    header:write("#include \"nyx/arena.h\"\n")
+  end
+  if Options.streaming then
+    header:write("#include \"nyx/stream.h\"\n")
+  end
+  if Options.parallel then
+    header:write("#include \"nyx/workers.h\"\n")
+  end
+  if Options.bytecode then
+    header:write("#include \"nyx/vm.h\"\n")
+  end
+  if Options.instrument then
+    header:write("#include \"nyx/profile.h\"\n")
+  end
+  if Options.recycle then
+    header:write("#include \"nyx/pool.h\"\n")
+  end
+  if Options.layout then
+    header:write("\n",
+                 "#include <ostream>\n")
+  end
+  header:write("\n",
                "#include <string>\n",
                "#include <vector>\n",
                "#include <cstddef>\n",
                "#include <cstdint>\n",
+               "#include <algorithm>\n",
                "\n\n",
                "namespace std {\n\n\n",
                "typedef ptrdiff_t ssize_t;\n\n\n",
@@ -103,12 +221,12 @@ TypeMap = {
   f32  = 'float',
   f32l = 'float',
   f32b = 'float',
-  u64  = 'std::uint32_t',
-  u64l = 'std::uint32_t',
-  u64b = 'std::uint32_t',
-  i64  = 'std::int32_t',
-  i64l = 'std::int32_t',
-  i64b = 'std::int32_t',
+  u64  = 'std::uint64_t',
+  u64l = 'std::uint64_t',
+  u64b = 'std::uint64_t',
+  i64  = 'std::int64_t',
+  i64l = 'std::int64_t',
+  i64b = 'std::int64_t',
   f64  = 'double',
   f64l = 'double',
   f64b = 'double',
@@ -116,6 +234,26 @@ TypeMap = {
 };
 
 
+-- size and alignment of what members can hold, as on a typical 64 bit host;
+-- they steer the member order, and each generated rule adds its own
+Layouts = {
+  ['std::uint8_t']      = { size =  1, align = 1 },
+  ['std::int8_t']       = { size =  1, align = 1 },
+  ['char']              = { size =  1, align = 1 },
+  ['std::uint16_t']     = { size =  2, align = 2 },
+  ['std::int16_t']      = { size =  2, align = 2 },
+  ['std::uint32_t']     = { size =  4, align = 4 },
+  ['std::int32_t']      = { size =  4, align = 4 },
+  ['float']             = { size =  4, align = 4 },
+  ['std::uint64_t']     = { size =  8, align = 8 },
+  ['std::int64_t']      = { size =  8, align = 8 },
+  ['double']            = { size =  8, align = 8 },
+  ['std::string']       = { size = 32, align = 8 },
+  ['nyx::arena_string'] = { size = 40, align = 8 },
+  ['nyx::view']         = { size = 16, align = 8 },
+}
+
+
 function findInPattern(name, pattern)
   for i = 1, #pattern do
     local pat = pattern[i]
@@ -152,6 +290,70 @@ function findInPattern(name, pattern)
 end
 
 
+function findStage(name, pattern)
+  for i = 1, #pattern do
+    local pat = pattern[i]
+
+    if pat.ident == name then
+      return pat
+    elseif pat["type"] == 'Group' then
+      local stage = findStage(name, pat)
+      if stage ~= nil then
+        return stage
+      end
+    end
+  end
+
+  return nil
+end
+
+
+function isByteRun(name, pattern)
+  local stage = findStage(name, pattern)
+
+  if stage == nil or stage.maximum == 1 then
+    return false
+  end
+
+  return stage["type"] == 'PatternMatch' or
+         (stage["type"] == 'Numeric' and stage.pattern["type"] == 'u8')
+end
+
+
+function isNativeType(kind)
+  for _, native in pairs(TypeMap) do
+    if native == kind then
+      return true
+    end
+  end
+
+  return false
+end
+
+
+-- loop condition covering every repetition a stage allows
+function repeatLimit(stage, storage)
+  if type(stage.maximum) == "number" and stage.maximum > 0 then
+    return "_rep__ < " .. stage.maximum
+  elseif type(stage.maximum) == "string" then
+    return "_rep__ < " .. repeatCount(stage.maximum, storage)
+  end
+
+  return "true"
+end
+
+
+function repeatCount(bound, storage)
+  local kind = storage[bound]
+
+  if kind == nil or type(kind.resolved) ~= 'string' or isNativeType(kind.resolved) then
+    return bound
+  end
+
+  return bound .. '.val'
+end
+
+
 function resolveType(storage, pattern)
   local tbl = storage["type"]
 
@@ -159,7 +361,12 @@ function resolveType(storage, pattern)
     return table.concat(tbl, '::')
   elseif #tbl == 1 then
     if tbl[1] == 'vector' then
+      if Options.arena then
+        return 'nyx::arena_vector<' .. findInPattern(storage.name, pattern) .. '>'
+      end
       return 'std::vector<' .. findInPattern(storage.name, pattern) .. '>'
+    elseif tbl[1] == 'string' and Options.arena then
+      return 'nyx::arena_string'
     elseif TypeMap[tbl[1]] ~= nil then
       return TypeMap[tbl[1]]
     end
@@ -182,27 +389,346 @@ function resolveType(storage, pattern)
 end
 
 
-function generateRuleStorage(header, storage, pattern)
+-- names the matching itself depends on: repeat counts and the discriminants
+-- of @match
+function collectReferences(pattern, refs)
+  for i = 1, #pattern do
+    local stage = pattern[i]
+
+    if type(stage.minimum) == 'string' then
+      refs[stage.minimum] = true
+    end
+    if type(stage.maximum) == 'string' then
+      refs[stage.maximum] = true
+    end
+    if stage["type"] == 'Select' then
+      refs[string.match(stage.pattern.reference, "^[^.]+")] = true
+    elseif stage["type"] == 'Group' then
+      collectReferences(stage, refs)
+    end
+  end
+
+  return refs
+end
+
+
+-- names read or written by decode and validate code
+function collectSexprNames(node, refs)
+  if node == nil or type(node) ~= 'table' then
+    return refs
+  elseif node["type"] == 'Identifier' and type(node.value) == 'table' then
+    refs[node.value[1]] = true
+  elseif node["type"] == 'Sexpr' then
+    collectSexprNames(node.value, refs)
+  end
+
+  for i = 1, #node do
+    collectSexprNames(node[i], refs)
+  end
+
+  return refs
+end
+
+
+-- whether matching a rule can be turned down by a validate of its own or of a
+-- rule it holds, which skip() would not run; rules from other namespaces
+-- cannot be looked into and are taken to validate
+function hasValidation(name, seen)
+  local rule = Rules[name]
+  if rule == nil then
+    return true
+  elseif seen[name] then
+    return false
+  end
+  seen[name] = true
+
+  if rule.validate ~= nil then
+    return true
+  end
+
+  local function stagesValidate(stages)
+    for i = 1, #stages do
+      local stage = stages[i]
+
+      if stage["type"] == 'Group' then
+        if stagesValidate(stage) then
+          return true
+        end
+      elseif stage["type"] == 'Identifier' and TypeMap[stage.pattern] == nil then
+        if hasValidation(stage.pattern, seen) then
+          return true
+        end
+      elseif stage["type"] == 'Select' then
+        local kinds = selectKinds(stage.pattern)
+        for j = 1, #kinds do
+          if TypeMap[kinds[j]] == nil and hasValidation(kinds[j], seen) then
+            return true
+          end
+        end
+      end
+    end
+
+    return false
+  end
+
+  return stagesValidate(rule.pattern)
+end
+
+
+-- a member can be lazy when it holds a sub-rule nothing else in the rule
+-- needs while decoding, and whose match skip() finds exactly as consume would
+function isLazyMember(rule, name)
+  if not Options.lazy or Options.lazy ~= true and Lazy[rule.name .. '.' .. name] == nil then
+    return false
+  end
+
+  local stage = findStage(name, rule.pattern)
+  if stage == nil or stage["type"] ~= 'Identifier' or TypeMap[stage.pattern] ~= nil then
+    return false
+  end
+
+  local refs = collectReferences(rule.pattern, {})
+  collectSexprNames(rule.decode, refs)
+  collectSexprNames(rule.validate, refs)
+  if refs[name] then
+    if Options.lazy ~= true then
+      io.write("Member '", rule.name, ".", name, "' is needed while decoding, it cannot be lazy\n")
+    end
+    return false
+  end
+
+  -- skipping over a match that validation would turn down changes where a
+  -- repetition stops, and with it what the parent accepts
+  if hasValidation(stage.pattern, {}) then
+    if Options.lazy ~= true then
+      io.write("Member '", rule.name, ".", name, "' is validated while decoding, it cannot be lazy\n")
+    end
+    return false
+  end
+
+  return true
+end
+
+
+function isLazy(stage, storage)
+  return stage.ident ~= nil and storage[stage.ident] ~= nil and storage[stage.ident].lazy
+end
+
+
+-- vector members holding repetitions of a columnar rule hold its batch, unless
+-- the rule's own code needs to reach into the records
+function isColumnarMember(rule, name)
+  local stage = findStage(name, rule.pattern)
+  if stage == nil or stage["type"] ~= 'Identifier' or stage.maximum == 1 or not Columnar[stage.pattern] then
+    return false
+  end
+
+  local refs = collectReferences(rule.pattern, {})
+  collectSexprNames(rule.decode, refs)
+  collectSexprNames(rule.validate, refs)
+  if refs[name] then
+    io.write("Member '", rule.name, ".", name, "' is needed while decoding, it stays a vector\n")
+    return false
+  end
+
+  return true
+end
+
+
+function isColumnar(stage, storage)
+  return stage.ident ~= nil and storage[stage.ident] ~= nil and storage[stage.ident].columnar
+end
+
+
+-- sub-rule repetitions kept in a vector are what the parallel overload hands
+-- to the pool
+function isParallel(stage, storage)
+  return Options.parallel and stage["type"] == 'Identifier' and stage.maximum ~= 1 and
+         TypeMap[stage.pattern] == nil and not stage.skip and stage.ident ~= nil and storage[stage.ident] ~= nil and
+         not isLazy(stage, storage) and not isColumnar(stage, storage)
+end
+
+
+function hasParallel(rule)
+  if not Options.parallel or rule.storage == nil then
+    return false
+  end
+
+  -- decided ahead of the storage itself, so only what isParallel looks at
+  local storage = {}
+  for i = 1, #rule.storage do
+    local name = rule.storage[i].name
+    storage[name] = { lazy = isLazyMember(rule, name), columnar = isColumnarMember(rule, name) }
+  end
+
+  for i = 1, #rule.pattern do
+    local alternate = rule.pattern[i]
+
+    if alternate["type"] == 'Group' then
+      for j = 1, #alternate do
+        if isParallel(alternate[j], storage) then
+          return true
+        end
+      end
+    elseif isParallel(alternate, storage) then
+      return true
+    end
+  end
+
+  return false
+end
+
+
+-- members laid out one after the other in the given order, as a struct
+function structLayout(members)
+  local size, align = 0, 1
+
+  for i = 1, #members do
+    local member = members[i]
+    size = size + (member.align - size % member.align) % member.align + member.size
+    align = math.max(align, member.align)
+  end
+
+  size = size + (align - size % align) % align
+  return { size = math.max(size, 1), align = align }
+end
+
+
+function layoutOf(kind)
+  if type(kind) == 'table' then
+    -- a @match, its nyx::choice is the largest case and two tags
+    local cases = selectKinds(kind)
+    local data = { size = 1, align = 1 }
+    for i = 1, #cases do
+      local case = layoutOf(cases[i])
+      data = { size = math.max(data.size, case.size), align = math.max(data.align, case.align) }
+    end
+    return structLayout({ data, Layouts['std::int8_t'], Layouts['std::int8_t'] })
+  elseif Layouts[kind] ~= nil then
+    return Layouts[kind]
+  elseif string.match(kind, '^std::vector<') then
+    return { size = 24, align = 8 }
+  elseif string.match(kind, '^nyx::arena_vector<') or string.match(kind, '^nyx::reuse_vector<') then
+    return { size = 32, align = 8 }
+  end
+
+  local element, count = string.match(kind, '^nyx::inline_vector<(.*), (%d+)>$')
+  if element ~= nil then
+    local slot = layoutOf(element)
+    return structLayout({ { size = slot.size * tonumber(count), align = slot.align },
+                          Layouts['std::uint64_t'] })
+  end
+
+  local target = string.match(kind, '^nyx::lazy<(.*)>$')
+  if target ~= nil then
+    return structLayout({ Layouts['std::uint64_t'], Layouts['std::uint64_t'], layoutOf(target),
+                          Layouts['std::int32_t'] })
+  end
+
+  -- a rule, perhaps from another namespace; assume a pointer's worth if it has
+  -- not been generated yet
+  return Layouts[string.match(kind, '([%w_]+)$')] or { size = 8, align = 8 }
+end
+
+
+-- most bytes a bounded repetition may take up to be held inside its object
+InlineLimit = 64
+
+
+-- strings and vectors of repetitions with a small literal bound are held in
+-- a nyx::inline_vector instead, which needs no allocation; nil otherwise,
+-- including for a single repetition, which is stored as a scalar
+function inlineType(entry, pattern, kind)
+  local raw = entry["type"]
+  if #raw ~= 1 or (raw[1] ~= 'string' and raw[1] ~= 'vector') then
+    return nil
+  end
+
+  local stage = findStage(entry.name, pattern)
+  if stage == nil or type(stage.maximum) ~= 'number' or stage.maximum < 2 then
+    return nil
+  end
+
+  local element = raw[1] == 'string' and 'char' or string.match(kind, '^[^<]+<(.*)>$')
+  if element == nil or layoutOf(element).size * stage.maximum > InlineLimit then
+    return nil
+  end
+
+  return 'nyx::inline_vector<' .. element .. ', ' .. stage.maximum .. '>'
+end
+
+
+function generateRuleStorage(header, storage, pattern, rule)
   local map = {}
+  local members = {}
   header:write("\n\n");
 
   for i = 1, #storage do
     local entry = storage[i]
     local kind = resolveType(entry, pattern)
+    local raw = entry["type"]
+    local view = false
+    local lazy = false
+    local columnar = false
+
+    if Options.views and #raw == 1 and (raw[1] == 'string' or raw[1] == 'vector') and
+       isByteRun(entry.name, pattern) then
+      kind = 'nyx::view'
+      view = true
+    elseif #raw == 1 and raw[1] == 'vector' and isColumnarMember(rule, entry.name) then
+      kind = findStage(entry.name, pattern).pattern .. '_batch'
+      columnar = true
+    elseif type(kind) == 'string' and isLazyMember(rule, entry.name) then
+      local target = findStage(entry.name, pattern).pattern
+      if kind == target then
+        kind = 'nyx::lazy<' .. target .. '>'
+      else
+        -- a vector of them, swap the element type
+        kind = string.sub(kind, 1, -#target - 2) .. 'nyx::lazy<' .. target .. '>>'
+      end
+      lazy = true
+    elseif type(kind) == 'string' and inlineType(entry, pattern, kind) ~= nil then
+      kind = inlineType(entry, pattern, kind)
+    elseif Options.recycle and #raw == 1 and raw[1] == 'vector' then
+      local stage = findStage(entry.name, pattern)
+      if stage ~= nil and stage["type"] == 'Identifier' and TypeMap[stage.pattern] == nil then
+        kind = 'nyx::reuse_vector<' .. stage.pattern .. '>'
+      end
+    end
 
+    local decl
     if type(kind) == 'string' then
-      header:write('    ', kind, ' ', entry.name, ';\n')
+      decl = kind .. ' ' .. entry.name
     else
-      local keys = kind.keys
-
-      for i = 1, #keys do
-        header:write('    ', kind[keys[i]], ' ', kind[keys[i]], '_', entry.name, ';\n')
-      end
+      -- only one case is ever decoded, so they share the space
+      decl = 'nyx::choice<' .. table.concat(selectKinds(kind), ', ') .. '> ' .. entry.name
     end
 
-    map[entry.name] = { raw = entry["type"], resolved = kind }
+    local layout = layoutOf(kind)
+    members[i] = { decl = decl, size = layout.size, align = layout.align, order = i }
+    map[entry.name] = { raw = raw, resolved = kind, view = view, lazy = lazy, columnar = columnar }
+  end
+
+  -- layout() compares against the members as they were listed
+  rule.declared = {}
+  for i = 1, #members do
+    rule.declared[i] = members[i].decl
+  end
+
+  -- widest alignment first leaves padding only at the end; ties keep storage
+  -- order
+  table.sort(members, function(one, two)
+    if one.align ~= two.align then
+      return one.align > two.align
+    end
+    return one.order < two.order
+  end)
+  for i = 1, #members do
+    header:write('    ', members[i].decl, ';\n')
   end
 
+  Layouts[rule.name] = structLayout(members)
+
   return map
 end
 
@@ -212,14 +738,17 @@ function sexprToCpp(code, decode)
     local op = decode.value
 
     if op.mode ~= nil and op.mode == "BinOp" then
-      sexprToCpp(code, decode[1])
-      code:write(' ', op.value, ' ')
-      if decode[2]["type"] == 'Sexpr' then
-        code:write('(')
-        sexprToCpp(code, decode[2])
-        code:write(')')
-      else
-        sexprToCpp(code, decode[2])
+      for i = 1, #decode do
+        if i > 1 then
+          code:write(' ', op.value, ' ')
+        end
+        if decode[i]["type"] == 'Sexpr' then
+          code:write('(')
+          sexprToCpp(code, decode[i])
+          code:write(')')
+        else
+          sexprToCpp(code, decode[i])
+        end
       end
     elseif op["type"] == 'Identifier' then
       if #op.value == 1 and TypeMap[op.value[1]] ~= nil then
@@ -264,6 +793,8 @@ function sexprToCpp(code, decode)
     code:write(decode.value)
   elseif decode["type"] == 'StringLiteral' then
     code:write('"', decode.value, '"')
+  elseif decode["type"] == 'Span' then
+    code:write(decode.value)
   else
     print("Invalid Sexpr:",dump(decode.value))
     for i = 1, #decode do
@@ -274,268 +805,1760 @@ function sexprToCpp(code, decode)
 end
 
 
-function generateConsumeStage(code, stage, storage, final)
-  if stage["type"] == 'Identifier' or
-     stage["type"] == 'PatternMatch' or
-     stage["type"] == 'Numeric' then
-    if stage.ident ~= nil and storage[stage.ident] ~= nil then
-      local raw = storage[stage.ident].raw
+-- condition that holds when fewer than bytes remain in the input; streaming
+-- decoders also note the shortfall so it can be reported to the caller
+function lacks(bytes, avail)
+  avail = avail or "_max__ - _idx__"
 
-      if raw ~= nil and #raw == 1 then
-        if raw[1] == 'string' or raw[1] == 'vector' then
-          code:write("    ", stage.ident, ".clear();\n")
-        elseif stage["type"] == 'Numeric' then
-          code:write("    ", stage.ident, " = 0;\n")
-        end
-      end
-    elseif stage.ident ~= nil and storage[stage.ident] == nil then
-      if stage["type"] == 'Numeric' then
-        code:write("    ", TypeMap[stage.pattern["type"]], ' ', stage.ident, " = 0;\n")
-      elseif stage["type"] == 'Identifier' then
-        code:write("    ", stage.pattern, ' ', stage.ident, ";\n")
-      end
+  if Options.streaming then
+    return "nyx::starved(_need__, " .. avail .. ", " .. bytes .. ")"
+  end
+
+  return avail .. " < " .. bytes
+end
+
+
+-- value consume returns when no alternate matched
+function failure()
+  if Options.streaming then
+    return "nyx::failure(_need__)"
+  end
+
+  return "-1"
+end
+
+
+-- the distinct types a Select stage can hold, one storage member each
+function selectKinds(pat)
+  local kinds = {}
+  local seen = {}
+
+  local function add(kind)
+    if not seen[kind] then
+      seen[kind] = true
+      kinds[#kinds + 1] = kind
     end
   end
 
-  if type(stage.maximum) == "number" and stage.maximum > 0 then
-    code:write("    for(_rep__ = 0; _rep__ < ", stage.maximum, "; ++_rep__) {\n")
-  elseif type(stage.maximum) == "string" then
-    local kind = storage[stage.maximum]
+  for i = 1, #pat.keys do
+    add(pat[pat.keys[i]])
+  end
+  for i = 1, #(pat.ranges or {}) do
+    add(pat.ranges[i][3])
+  end
 
-    if kind == nil or TypeMap[kind.resolved] ~= nil then
-      code:write("    for(_rep__ = 0; _rep__ < ", stage.maximum, "; ++_rep__) {\n")
-    else
-      code:write("    for(_rep__ = 0; _rep__ < ", stage.maximum, ".val; ++_rep__) {\n")
+  return kinds
+end
+
+
+-- the cases of a Select stage as key intervals: single keys in the order they
+-- are to be tested followed by any ranges
+function selectCases(stage)
+  local pat = stage.pattern
+  local cases = {}
+
+  for i = 1, #pat.keys do
+    local key = pat.keys[i]
+    cases[#cases + 1] = { low = key, high = key, kind = pat[key], label = caseLabel(stage, key) }
+  end
+  for i = 1, #(pat.ranges or {}) do
+    local range = pat.ranges[i]
+    cases[#cases + 1] = {
+      low = range[1], high = range[2], kind = range[3],
+      label = caseLabel(stage, range[1] .. '..' .. range[2])
+    }
+  end
+
+  return cases
+end
+
+
+-- keys per switch label below which a switch is still considered dense
+SelectDensity = 4
+
+-- most keys that are spelled out as switch labels
+SelectLabels = 256
+
+
+-- dispatches a Select stage on its reference, leaving what the chosen case
+-- consumed in result, -1 when no case matches; call maps a case type to the
+-- function to call. A couple of keys are compared in turn, keys close enough
+-- together become a switch the compiler can lower to a jump table, and sparse
+-- keys or wide ranges are found by binary search through a sorted table of
+-- intervals whose position is then switched on
+function generateSelect(code, stage, indent, counted, call)
+  local cases = selectCases(stage)
+  local reference = stage.pattern.reference
+
+  local function body(case, inner)
+    if counted then
+      code:write(inner, "_prof__.hit(", Counters[case.label], ");\n")
     end
-  else
-    code:write("    for(_rep__ = 0; true; ++_rep__) {\n")
+    local fn = call(case.kind)
+    code:write(inner, "result = ", fn, callArgs(fn), ";\n")
   end
 
-  if stage["type"] == 'ExactMatch' then
-    local arr = stage.pattern
-    code:write("      if(_max__ - _idx__ < ", #arr, " ||\n")
-    for i = 1, #arr - 1, 1 do
-      code:write("         _raw__[_idx__ + ", i - 1, "] != ", arr[i], " ||\n")
+  code:write(indent, "std::ptrdiff_t result = -1;\n")
+
+  local ranged = stage.pattern.ranges ~= nil and #stage.pattern.ranges > 0
+  if #cases <= 2 and not ranged then
+    -- kept in order, which is hottest first under a profile
+    for i = 1, #cases do
+      code:write(indent, i == 1 and "if(" or "else if(", reference, " == ", cases[i].low, ") {\n")
+      body(cases[i], indent .. "  ")
+      code:write(indent, "}\n")
     end
-    code:write("         _raw__[_idx__ + ", #arr - 1, "] != ", arr[#arr], ") {\n",
-               "        break;\n",
-               "      }\n",
-               "      else {\n")
-    code:write("        _idx__ += ", #arr, ";\n",
-               "      }\n")
-  elseif stage["type"] == 'PatternMatch' then
-    local pat = stage.pattern
-    code:write("      if(_max__ - _idx__ < 1 ||\n",
-               "         (_raw__[_idx__] & ", pat.mask, ") != ", pat.value, ") {\n",
-               "        break;\n",
-               "      }\n",
-               "      else {\n")
-    if stage.ident ~= nil then
-      if stage.maximum ~= 1 then
-        code:write("        ", stage.ident, ".append(1, static_cast<char>(_raw__[_idx__]));\n")
-      else
-        code:write("        ", stage.ident, " = _raw__[_idx__];\n")
+    return
+  end
+
+  local sorted = {}
+  local labels = 0
+  for i = 1, #cases do
+    sorted[i] = cases[i]
+    labels = labels + (cases[i].high - cases[i].low + 1)
+  end
+  table.sort(sorted, function(one, two)
+    return one.low < two.low
+  end)
+
+  local span = sorted[#sorted].high - sorted[1].low + 1
+  if labels <= SelectLabels and span <= labels * SelectDensity then
+    code:write(indent, "switch(", reference, ") {\n")
+    for i = 1, #cases do
+      for key = cases[i].low, cases[i].high do
+        code:write(indent, "  case ", key, ":\n")
       end
+      body(cases[i], indent .. "    ")
+      code:write(indent, "  break;\n")
     end
-    code:write("        ++_idx__;\n",
-               "      }\n")
-  elseif stage["type"] == 'Numeric' then
-    local pat = stage.pattern
-    code:write("      if(_max__ - _idx__ < ", pat.size, ") {\n",
+    code:write(indent, "}\n")
+    return
+  end
+
+  local low, high = {}, {}
+  for i = 1, #sorted do
+    low[i] = sorted[i].low
+    high[i] = sorted[i].high
+  end
+
+  code:write(indent, "static const std::uint64_t _low__[] = { ", table.concat(low, ", "), " };\n",
+             indent, "static const std::uint64_t _high__[] = { ", table.concat(high, ", "), " };\n",
+             indent, "auto _key__ = static_cast<std::uint64_t>(", reference, ");\n",
+             indent, "auto _at__ = std::upper_bound(_low__, _low__ + ", #sorted, ", _key__) - _low__ - 1;\n",
+             indent, "if(_at__ >= 0 && _key__ <= _high__[_at__]) {\n",
+             indent, "  switch(_at__) {\n")
+  for i = 1, #sorted do
+    code:write(indent, "    case ", i - 1, ":\n")
+    body(sorted[i], indent .. "      ")
+    code:write(indent, "    break;\n")
+  end
+  code:write(indent, "  }\n",
+             indent, "}\n")
+end
+
+
+-- arguments a nested decode is called with; while streaming, consume is told
+-- whether more input may follow
+function callArgs(call)
+  if Options.streaming and string.match(call, 'consume$') then
+    return "(&_raw__[_idx__], _max__ - _idx__, _last__)"
+  end
+
+  return "(&_raw__[_idx__], _max__ - _idx__)"
+end
+
+
+-- failure exits taken on the result of a nested consume
+function generateCarry(code, indent)
+  if Options.streaming then
+    code:write(indent, "nyx::carry(_need__, result);\n")
+  end
+end
+
+
+function isView(stage, storage)
+  return stage.ident ~= nil and storage[stage.ident] ~= nil and storage[stage.ident].view
+end
+
+
+function isBulkNumeric(stage, storage)
+  if stage["type"] ~= 'Numeric' or stage.minimum ~= stage.maximum or stage.maximum == 1 then
+    return false
+  end
+
+  if type(stage.maximum) == 'number' and stage.maximum < 1 then
+    return false
+  end
+
+  -- unnamed runs are stepped over in one go
+  if stage.ident == nil then
+    return true
+  elseif storage[stage.ident] == nil then
+    return false
+  end
+
+  local raw = storage[stage.ident].raw
+  return storage[stage.ident].view or (#raw == 1 and raw[1] == 'vector')
+end
+
+
+-- a repeated numeric stage with a known count is decoded with a single bounds
+-- check and a bulk copy rather than an element at a time; a count read from
+-- the input is taken as a std::size_t and refused when negative, and resume
+-- suspends rather than failing when the run is not all there yet
+function generateBulkNumeric(code, stage, storage, checked, resume)
+  local pat = stage.pattern
+  local bytes = pat.size ~= 1 and "_cnt__ * " .. pat.size or "_cnt__"
+
+  code:write("    {\n")
+  if type(stage.maximum) == 'string' then
+    code:write("      std::size_t _cnt__;\n",
+               "      if(!nyx::repeat_count(", repeatCount(stage.maximum, storage),
+                        ", static_cast<std::size_t>(-1) / ", pat.size, ", _cnt__)) {\n",
+               "        break;\n",
+               "      }\n")
+  else
+    code:write("      const std::size_t _cnt__ = ", stage.maximum, ";\n")
+  end
+
+  if resume then
+    generateSuspend(code, bytes, "      ")
+  elseif not checked then
+    code:write("      if(", lacks(bytes), ") {\n",
+               "        break;\n",
+               "      }\n")
+  end
+
+  if stage.ident == nil then
+    -- nothing to keep
+  elseif isView(stage, storage) then
+    code:write("      ", stage.ident, " = nyx::view(&_raw__[_idx__], _cnt__);\n")
+  elseif pat.size == 1 then
+    code:write("      ", stage.ident, ".assign(&_raw__[_idx__], &_raw__[_idx__ + _cnt__]);\n")
+  else
+    code:write("      ", stage.ident, ".resize(_cnt__);\n",
+               "      nyx::unpack<nyx::byte_order::", pat.order, ">(", stage.ident,
+                          ".data(), &_raw__[_idx__], _cnt__);\n")
+  end
+
+  code:write("      _idx__ += ", bytes, ";\n",
+             "    }\n\n")
+end
+
+
+function isScannable(stage)
+  if stage["type"] ~= 'PatternMatch' or stage.maximum == 1 then
+    return false
+  end
+
+  return type(stage.maximum) == 'string' or stage.maximum < 0 or stage.maximum > 16
+end
+
+
+-- long or unbounded wildcard runs are measured with nyx::scan, which tests
+-- many bytes at a time, and then taken in one go; the run length stays a
+-- std::size_t, and counts read from the input go through nyx::repeat_count so
+-- a negative one is refused rather than widened
+function generateScan(code, stage, storage)
+  local pat = stage.pattern
+
+  code:write("    {\n")
+  if type(stage.maximum) == 'string' then
+    code:write("      std::size_t _lim__;\n",
+               "      if(!nyx::repeat_count(", repeatCount(stage.maximum, storage), ", static_cast<std::size_t>(-1), _lim__)) {\n",
+               "        break;\n",
+               "      }\n")
+  elseif stage.maximum > 0 then
+    code:write("      const std::size_t _lim__ = ", stage.maximum, ";\n")
+  else
+    code:write("      const std::size_t _lim__ = static_cast<std::size_t>(-1);\n")
+  end
+
+  code:write("      const std::size_t _cnt__ = nyx::scan(&_raw__[_idx__], std::min<std::size_t>(_lim__, _max__ - _idx__), ",
+                                                         pat.mask, ", ", pat.value, ");\n")
+  if Options.streaming then
+    -- a run cut short by the end of the input, rather than by its bound,
+    -- might have gone on
+    code:write("      if(_cnt__ < _lim__ && _idx__ + _cnt__ == _max__) {\n",
+               "        nyx::starved(_need__, 0, 1);\n",
+               "      }\n")
+  end
+
+  if type(stage.minimum) == "number" and stage.minimum > 0 then
+    code:write("      if(_cnt__ < ", stage.minimum, ") {\n",
+               "        break;\n",
+               "      }\n")
+  elseif type(stage.minimum) == 'string' then
+    code:write("      std::size_t _low__;\n",
+               "      if(!nyx::repeat_count(", repeatCount(stage.minimum, storage),
+                        ", static_cast<std::size_t>(-1), _low__) || _cnt__ < _low__) {\n",
+               "        break;\n",
+               "      }\n")
+  end
+
+  if isView(stage, storage) then
+    code:write("      ", stage.ident, " = nyx::view(&_raw__[_idx__], _cnt__);\n")
+  elseif stage.ident ~= nil then
+    code:write("      ", stage.ident, ".assign(reinterpret_cast<const char *>(&_raw__[_idx__]), _cnt__);\n")
+  end
+  code:write("      _idx__ += _cnt__;\n",
+             "    }\n\n")
+end
+
+
+-- decodes the numeric at _idx__ into the stage's target, the caller has
+-- already made sure the bytes are there
+function generateNumericValue(code, stage, indent)
+  local pat = stage.pattern
+  local value = "nyx::load<" .. TypeMap[pat["type"]] .. ", nyx::byte_order::" .. pat.order ..
+                ">(&_raw__[_idx__])"
+
+  if stage.maximum ~= 1 then
+    code:write(indent, stage.ident, ".emplace_back(", value, ");\n")
+  else
+    code:write(indent, stage.ident, " = ", value, ";\n")
+  end
+end
+
+
+-- fewest bytes an element of a sub-rule repetition takes, at least one
+function elementSize(stage)
+  local rule = Rules[stage.pattern]
+
+  if rule ~= nil and type(rule.minsize) == 'number' and rule.minsize > 0 then
+    return rule.minsize
+  elseif type(stage.minimum) == 'number' and stage.minimum > 0 and type(stage.minsize) == 'number' then
+    return math.max(1, math.floor(stage.minsize / stage.minimum))
+  end
+
+  return 1
+end
+
+
+-- sub-rule repetitions collected into a vector reserve their final size up
+-- front when the count is known, or in two pass mode count the elements with
+-- skip() first; a count read from the input is refused when negative and
+-- reserves no more elements than the remaining input could hold
+function generateReserve(code, stage, storage, indent)
+  if stage["type"] ~= 'Identifier' or stage.maximum == 1 or storage[stage.ident].view then
+    return
+  end
+
+  if type(stage.maximum) == 'string' then
+    code:write(indent, "{\n",
+               indent, "  std::size_t _cap__;\n",
+               indent, "  if(!nyx::repeat_count(", repeatCount(stage.maximum, storage), ", (_max__ - _idx__) / ",
+                       elementSize(stage), ", _cap__)) {\n",
+               indent, "    break;\n",
+               indent, "  }\n",
+               indent, "  ", stage.ident, ".reserve(_cap__);\n",
+               indent, "}\n")
+  elseif stage.maximum > 1 and stage.minimum == stage.maximum then
+    code:write(indent, stage.ident, ".reserve(", stage.maximum, ");\n")
+  elseif stage.maximum < 0 and Options.twopass then
+    code:write(indent, "{\n",
+               indent, "  std::size_t _pos__ = _idx__, _count__ = 0;\n",
+               indent, "  for(std::ssize_t result; (result = ", stage.pattern, "::skip(&_raw__[_pos__], _max__ - _pos__)) >= 0; ++_count__) {\n",
+               indent, "    _pos__ += result;\n",
+               indent, "  }\n",
+               indent, "  ", stage.ident, ".reserve(_count__);\n",
+               indent, "}\n")
+  end
+end
+
+
+-- the elements of a repetition are first measured with skip() and then decoded
+-- side by side into a vector sized to fit; should one not decode to the length
+-- skip gave it, the vector ends just before it and the sequential loop that
+-- follows carries on from there, so the outcome matches a sequential consume
+function generateParallel(code, stage, storage)
+  local ident = stage.ident
+
+  code:write("    {\n",
+             "      std::vector<std::size_t> _ends__;\n",
+             "      const std::size_t _base__ = _idx__;\n",
+             "      std::size_t _pos__ = _idx__;\n",
+             "      for(_rep__ = 0; ", repeatLimit(stage, storage), "; ++_rep__) {\n",
+             "        auto result = ", stage.pattern, "::skip(&_raw__[_pos__], _max__ - _pos__);\n",
+             "        if(result < 0) {\n",
+             "          break;\n",
+             "        }\n",
+             "        _ends__.push_back(_pos__ += result);\n",
+             "      }\n\n",
+             "      std::vector<char> _ok__(_ends__.size());\n",
+             "      ", ident, ".resize(_ends__.size());\n",
+             "      _pool__.parallel_for(_ends__.size(), [&](std::size_t _elt__) {\n",
+             "        std::size_t _from__ = _elt__ ? _ends__[_elt__ - 1] : _base__;\n",
+             "        _ok__[_elt__] = ", ident, "[_elt__].consume(&_raw__[_from__], _max__ - _from__) ==\n",
+             "                        static_cast<std::ssize_t>(_ends__[_elt__] - _from__);\n",
+             "      });\n\n",
+             "      _rep__ = std::find(_ok__.begin(), _ok__.end(), 0) - _ok__.begin();\n",
+             "      ", ident, ".resize(_rep__);\n",
+             "      if(_rep__ > 0) {\n",
+             "        _idx__ = _ends__[_rep__ - 1];\n",
+             "      }\n",
+             "    }\n")
+end
+
+
+-- whether an alternate has a stage matched an element at a time in a _rep__
+-- loop, rather than in one go by a bulk copy or a scan
+function hasRepeatLoop(alternate, storage)
+  local stages = alternate["type"] == 'Group' and alternate or { alternate }
+
+  for i = 1, #stages do
+    if not isBulkNumeric(stages[i], storage) and not isScannable(stages[i]) then
+      return true
+    end
+  end
+
+  return false
+end
+
+
+-- checked is true when the bytes for every repetition of the stage are already
+-- known to be available; parallel is true in the overload that takes a pool
+function generateConsumeStage(code, stage, storage, checked, parallel)
+  if isBulkNumeric(stage, storage) then
+    generateBulkNumeric(code, stage, storage, checked)
+    return
+  elseif isScannable(stage) then
+    generateScan(code, stage, storage)
+    return
+  end
+
+  if stage["type"] == 'Identifier' or
+     stage["type"] == 'PatternMatch' or
+     stage["type"] == 'Numeric' then
+    if stage.ident ~= nil and storage[stage.ident] ~= nil then
+      local raw = storage[stage.ident].raw
+
+      if raw ~= nil and #raw == 1 then
+        if storage[stage.ident].view then
+          -- assigned in one go once the run has been matched
+        elseif raw[1] == 'string' or raw[1] == 'vector' then
+          code:write("    ", stage.ident, ".clear();\n")
+          if not (parallel and isParallel(stage, storage)) then
+            generateReserve(code, stage, storage, "    ")
+          end
+        elseif stage["type"] == 'Numeric' then
+          code:write("    ", stage.ident, " = 0;\n")
+        end
+      end
+    elseif stage.ident ~= nil and storage[stage.ident] == nil then
+      if stage["type"] == 'Numeric' then
+        code:write("    ", TypeMap[stage.pattern["type"]], ' ', stage.ident, " = 0;\n")
+      elseif stage["type"] == 'Identifier' then
+        code:write("    ", stage.pattern, ' ', stage.ident, ";\n")
+      end
+    end
+  end
+
+  if parallel and isParallel(stage, storage) then
+    generateParallel(code, stage, storage)
+    code:write("    for(; ", repeatLimit(stage, storage), "; ++_rep__) {\n")
+  else
+    code:write("    for(_rep__ = 0; ", repeatLimit(stage, storage), "; ++_rep__) {\n")
+  end
+
+  if stage["type"] == 'ExactMatch' then
+    local arr = stage.pattern
+    code:write("      if(")
+    if not checked then
+      code:write(lacks(#arr), " ||\n         ")
+    end
+    for i = 1, #arr - 1, 1 do
+      code:write("_raw__[_idx__ + ", i - 1, "] != ", arr[i], " ||\n         ")
+    end
+    code:write("_raw__[_idx__ + ", #arr - 1, "] != ", arr[#arr], ") {\n",
+               "        break;\n",
+               "      }\n",
+               "      else {\n")
+    code:write("        _idx__ += ", #arr, ";\n",
+               "      }\n")
+  elseif stage["type"] == 'PatternMatch' then
+    local pat = stage.pattern
+    code:write("      if(")
+    if not checked then
+      code:write(lacks(1), " ||\n         ")
+    end
+    code:write("(_raw__[_idx__] & ", pat.mask, ") != ", pat.value, ") {\n",
                "        break;\n",
                "      }\n",
                "      else {\n")
-    if stage.maximum ~= 1 then
-      code:write("        ", TypeMap[pat["type"]], " _tmp__;\n")
-      if pat.order == 'big' then
-        code:write("        for(int i = 0; i < ", pat.size, "; ++i) {\n",
-                   "          _tmp__ = (_tmp__ << 8) | _raw__[_idx__ + i];\n",
-                   "        }\n",
-                   "        ", stage.ident, ".emplace_back(_tmp__);\n")
-      elseif pat.order == 'llittle' then
-        code:write("        for(int i = 0; i < ", pat.size, "; ++i) {\n",
-                   "          _tmp__ |= _raw__[_idx__ + i] << (i * 8);\n",
-                   "        }\n",
-                   "        ", stage.ident, ".emplace_back(_tmp__);\n")
+    if stage.ident ~= nil and not isView(stage, storage) then
+      if stage.maximum ~= 1 then
+        code:write("        ", stage.ident, ".append(1, static_cast<char>(_raw__[_idx__]));\n")
       else
-        code:write("        _tmp__ = *reinterpret_cast<const ", TypeMap[pat["type"]],
-                            " *>(&_raw__[_idx__]);\n",
-                   "        ", stage.ident, ".emplace_back(_tmp__);\n")
+        code:write("        ", stage.ident, " = _raw__[_idx__];\n")
       end
+    end
+    code:write("        ++_idx__;\n",
+               "      }\n")
+  elseif stage["type"] == 'Numeric' then
+    local pat = stage.pattern
+    if checked then
+      code:write("      {\n")
     else
-      if pat.order == 'big' then
-        code:write("        for(int i = 0; i < ", pat.size, "; ++i) {\n",
-                   "          ", stage.ident, " = (", stage.ident, " << 8) | _raw__[_idx__ + i];\n",
-                   "        }\n")
-      elseif pat.order == 'little' then
-        code:write("        for(int i = 0; i < ", pat.size, "; ++i) {\n",
-                   "          ", stage.ident, " |= _raw__[_idx__ + i] << (i * 8);\n",
-                   "        }\n")
-      else
-        code:write("        ", stage.ident,
-                   " = *reinterpret_cast<", TypeMap[pat["type"]], " *>(&_raw__[_idx__]);\n")
-      end
+      code:write("      if(", lacks(pat.size), ") {\n",
+                 "        break;\n",
+                 "      }\n",
+                 "      else {\n")
+    end
+    if stage.ident ~= nil and not isView(stage, storage) then
+      -- views pick the bytes up as a whole once the loop completes
+      generateNumericValue(code, stage, "        ")
     end
     code:write("        _idx__ += ", pat.size, ";\n",
                "      }\n")
   elseif stage["type"] == 'Identifier' then
-    if stage.ident ~= nil then
-      if stage.maximum ~= 1 then
-        code:write("      ", stage.ident, ".resize(", stage.ident, ".size() + 1);\n",
-                   "      auto result = ", stage.ident, ".back().consume(&_raw__[_idx__], _max__ - _idx__);\n",
+    if stage.skip or isLazy(stage, storage) then
+      code:write("      auto result = ", stage.pattern, "::skip(&_raw__[_idx__], _max__ - _idx__);\n",
+                 "      if(result < 0) {\n")
+    elseif stage.ident ~= nil then
+      if isColumnar(stage, storage) then
+        code:write("      auto result = ", stage.ident, ".append(&_raw__[_idx__], _max__ - _idx__);\n",
+                   "      if(result < 0) {\n")
+      elseif stage.maximum ~= 1 then
+        code:write("      ", stage.ident, ".emplace_back();\n",
+                   "      auto result = ", stage.ident, ".back().consume", callArgs('consume'), ";\n",
                    "      if(result < 0) {\n",
-                   "        ", stage.ident, ".resize(", stage.ident, ".size() - 1);\n",
-                   "        break;\n",
-                   "      }\n",
-                   "      _idx__ += result;\n")
+                   "        ", stage.ident, ".pop_back();\n")
       else
-        code:write("      auto result = ", stage.ident, ".consume(&_raw__[_idx__], _max__ - _idx__);\n",
-                   "      if(result < 0) {\n",
-                   "        break;\n",
-                   "      }\n",
-                   "      _idx__ += result;\n")
+        code:write("      auto result = ", stage.ident, ".consume", callArgs('consume'), ";\n",
+                   "      if(result < 0) {\n")
       end
     else
       code:write("      ", stage.pattern, " _tmp__;\n",
-                 "      auto result = _tmp__.consume(&_raw__[_idx__], _max__ - _idx__);\n",
-                 "      if(result < 0) {\n",
-                 "        break;\n",
-                 "      }\n",
-                 "      _idx__ += result;\n")
+                 "      auto result = _tmp__.consume", callArgs('consume'), ";\n",
+                 "      if(result < 0) {\n")
+    end
+    generateCarry(code, "        ")
+    code:write("        break;\n",
+               "      }\n")
+    if isLazy(stage, storage) and stage.maximum ~= 1 then
+      code:write("      ", stage.ident, ".emplace_back(&_raw__[_idx__], result);\n")
+    elseif isLazy(stage, storage) then
+      code:write("      ", stage.ident, ".assign(&_raw__[_idx__], result);\n")
     end
+    code:write("      _idx__ += result;\n")
   elseif stage["type"] == 'Select' then
-    local pat = stage.pattern
-    local keys = pat.keys
+    generateSelect(code, stage, "      ", Counters ~= nil and not stage.skip, function(kind)
+      if stage.skip then
+        return kind .. "::skip"
+      end
+      return stage.ident .. (Options.recycle and ".reuse<" or ".emplace<") .. kind .. ">().consume"
+    end)
+    code:write("      if(result < 0) {\n")
+    generateCarry(code, "        ")
+    code:write("        break;\n",
+               "      }\n",
+               "      _idx__ += result;\n")
+  else
+    io.write("Unhandled stage: ", dump(stage),'\n')
+  end
 
-    for i = 1, #keys do
-      if i == 1 then
-        code:write("      if(", pat.reference, " == ", keys[i], ") {\n")
-      else
-        code:write("      else if(", pat.reference, " == ", keys[i], ") {\n")
+  code:write("    }\n")
+  if isView(stage, storage) then
+    code:write("    ", stage.ident, " = nyx::view(&_raw__[_idx__ - _rep__], _rep__);\n")
+  end
+  if type(stage.minimum) == "number" and stage.minimum > 0 then
+    code:write("    if(_rep__ < ", stage.minimum, ") {\n")
+    code:write("      break;\n")
+    code:write("    }\n")
+  elseif type(stage.minimum) == 'string' then
+    code:write("    if(_rep__ < ", repeatCount(stage.minimum, storage), ") {\n")
+    code:write("      break;\n")
+    code:write("    }\n")
+  end
+  code:write("\n")
+end
+
+
+function shouldCaptureRawBytes(pattern, storage)
+  if pattern.ident ~= nil and storage[pattern.ident] == nil then
+    return true
+  end
+
+  return false
+end
+
+function generateBoundsCheck(code, bytes)
+  code:write("    if(", lacks(bytes), ") {\n",
+             "      break;\n",
+             "    }\n\n")
+end
+
+
+-- emits a sequence of stages, hoisting the bounds checks of each run of fixed
+-- size stages into a single check ahead of the run
+-- (concat a b ...) of members that byte run stages matched back to back holds
+-- exactly the input those stages covered, so it is read from there as a view
+-- instead of being copied together; marks collects the stage index each such
+-- span starts at, and the result is node with the spans swapped in
+function findSpans(node, stages, storage, written, marks)
+  if type(node) ~= 'table' or node["type"] ~= 'Sexpr' then
+    return node
+  end
+
+  local copy = {}
+  for key, val in pairs(node) do
+    copy[key] = val
+  end
+  for i = 1, #node do
+    copy[i] = findSpans(node[i], stages, storage, written, marks)
+  end
+
+  if sexprOp(node) ~= 'concat' or #node < 2 then
+    return copy
+  end
+
+  local first = nil
+  local sizes = {}
+  for i = 1, #node do
+    local name = sexprName(node[i])
+    if name == nil or storage[name] == nil or written[name] or not isByteRun(name, stages) then
+      return copy
+    end
+
+    local pos = nil
+    for j = 1, #stages do
+      if stages[j].ident == name then
+        pos = j
+      end
+    end
+    if pos == nil or (first ~= nil and pos ~= first + i - 1) then
+      return copy
+    end
+
+    first = first or pos
+    sizes[i] = name .. ".size()"
+  end
+
+  marks[first] = "_span" .. first .. "__"
+  return { ["type"] = 'Span',
+           value = "nyx::view(&_raw__[" .. marks[first] .. "], " .. table.concat(sizes, " + ") .. ")" }
+end
+
+
+-- marks names the stages whose starting offset a span in the code needs and
+-- checks holds the validate checks to make after each stage
+function generateConsumeStages(code, stages, storage, parallel, marks, checks)
+  local covered = 0
+  marks = marks or {}
+
+  if stages.minsize ~= nil and stages.minsize > 0 then
+    generateBoundsCheck(code, stages.minsize)
+    covered = stages.minsize
+  end
+
+  for i = 1, #stages do
+    local stage = stages[i]
+
+    if marks[i] ~= nil then
+      code:write("    std::ssize_t ", marks[i], " = _idx__;\n")
+    end
+
+    if stage.size ~= nil then
+      if covered < stage.size then
+        covered = 0
+        for j = i, #stages do
+          if stages[j].size == nil then
+            break
+          end
+          covered = covered + stages[j].size
+        end
+        generateBoundsCheck(code, covered)
+      end
+
+      generateConsumeStage(code, stage, storage, true, parallel)
+      covered = covered - stage.size
+    else
+      generateConsumeStage(code, stage, storage, false, parallel)
+      covered = 0
+    end
+
+    if checks ~= nil and checks[i] ~= nil then
+      for j = 1, #checks[i] do
+        generateCheck(code, checks[i][j])
+      end
+    end
+  end
+end
+
+
+-- leaves the alternate when expr does not hold
+function generateCheck(code, expr)
+  code:write("    if(!(")
+  sexprToCpp(code, expr)
+  code:write(")) {\n",
+             "      break;\n",
+             "    }\n\n")
+end
+
+
+-- names the stage binds, its own and those of the stages it groups
+function collectStageNames(stage, names)
+  if stage.ident ~= nil then
+    names[stage.ident] = true
+  end
+  if stage["type"] == 'Group' then
+    for i = 1, #stage do
+      collectStageNames(stage[i], names)
+    end
+  end
+
+  return names
+end
+
+
+-- splits a validate expression into the checks it is a conjunction of and
+-- files each under the stage that binds the last name it reads, so that a bad
+-- record is turned away before the stages after that are decoded; checks that
+-- read what decode writes or what the stages only have at the end, such as a
+-- raw capture, are filed under late and made after decode
+function placeChecks(expr, stages, storage, written, parallel)
+  local checks = { late = {} }
+  local conjuncts = {}
+
+  local function split(node)
+    if sexprOp(node) == '&&' then
+      for i = 1, #node do
+        split(node[i])
+      end
+    else
+      conjuncts[#conjuncts + 1] = node
+    end
+  end
+  split(expr)
+
+  local bound = {}
+  for i = 1, #stages do
+    for name in pairs(collectStageNames(stages[i], {})) do
+      bound[name] = i
+    end
+  end
+
+  for _, node in ipairs(conjuncts) do
+    local at = 0
+
+    for name in pairs(collectSexprNames(node, {})) do
+      if parallel or written[name] or name == stages.ident or (storage[name] ~= nil and bound[name] == nil) then
+        at = nil
+        break
+      elseif bound[name] ~= nil and bound[name] > at then
+        at = bound[name]
       end
-      code:write("        auto result = ", pat[keys[i]], '_', stage.ident,
-                          ".consume(&_raw__[_idx__], _max__ - _idx__);\n",
-                 "        if(result < 0) {\n",
-                 "          break;\n",
-                 "        }\n",
-                 "        _idx__ += result;\n",
-                 "      }")
     end
-    code:write("      else {\n",
-               "        break;\n",
-               "      }\n")
-  else
-    io.write("Unhandled stage: ", dump(stage),'\n')
+
+    -- a check that reads no stage at all is left where it was
+    if at == nil or at == 0 then
+      checks.late[#checks.late + 1] = node
+    else
+      checks[at] = checks[at] or {}
+      checks[at][#checks[at] + 1] = node
+    end
+  end
+
+  return checks
+end
+
+
+-- the nyx::vm::number naming each C++ numeric type
+VmNumber = {
+  ['std::uint8_t']  = 'u8',
+  ['std::int8_t']   = 'i8',
+  ['std::uint16_t'] = 'u16',
+  ['std::int16_t']  = 'i16',
+  ['std::uint32_t'] = 'u32',
+  ['std::int32_t']  = 'i32',
+  ['std::uint64_t'] = 'u64',
+  ['std::int64_t']  = 'i64',
+  float             = 'f32',
+  double            = 'f64',
+}
+
+
+function isBytecode(rule)
+  return Options.bytecode == true or Bytecode[rule.name] ~= nil
+end
+
+
+-- fills in how often an op repeats; a count must be a plain number held by a
+-- member or a local, the same one for both bounds
+function compileBounds(op, stage, storage, rule, slot)
+  for _, bound in ipairs({ 'minimum', 'maximum' }) do
+    local val = stage[bound]
+
+    if type(val) == 'number' then
+      op[bound] = val < 0 and 'nyx::vm::unbounded' or tostring(val)
+    else
+      local kind
+      if storage[val] ~= nil then
+        kind = storage[val].resolved
+      else
+        kind = findInPattern(val, rule.pattern)
+      end
+
+      if VmNumber[kind] == nil or (op.count ~= '-1' and op.count ~= slot(val)) then
+        return false
+      end
+
+      op[bound] = 'nyx::vm::counted'
+      op.count = slot(val)
+      op.width = VmNumber[kind]
+    end
+  end
+
+  return true
+end
+
+
+-- the op for one stage, nil when the vm cannot express it
+function compileStage(stage, storage, rule, program, slot)
+  local op = { code = 'halt', ["type"] = 'u8', order = 'machine', into = 'none', mask = 0, value = 0,
+               slot = '-1', count = '-1', width = 'u8', minimum = '0', maximum = '0',
+               bytes = 'nullptr', size = 0, call = 'nullptr', clear = 'nullptr' }
+  local member = stage.ident ~= nil and storage[stage.ident] or nil
+
+  if not compileBounds(op, stage, storage, rule, slot) then
+    return nil
+  end
+
+  if stage["type"] == 'ExactMatch' then
+    op.code = 'exact'
+    op.bytes = '_lit' .. (#program.literals + 1) .. '__'
+    op.size = #stage.pattern
+    program.literals[#program.literals + 1] = { name = op.bytes, bytes = stage.pattern }
+  elseif stage["type"] == 'PatternMatch' then
+    op.code = 'pattern'
+    op.mask = stage.pattern.mask
+    op.value = stage.pattern.value
+    if member ~= nil and member.view then
+      op.into = 'view'
+    elseif member ~= nil and stage.maximum ~= 1 and member.resolved == 'std::string' then
+      op.into = 'string'
+    elseif member ~= nil and stage.maximum == 1 and member.resolved == 'std::uint8_t' then
+      op.into = 'scalar'
+    elseif stage.ident ~= nil then
+      return nil
+    end
+  elseif stage["type"] == 'Numeric' then
+    local kind = TypeMap[stage.pattern["type"]]
+    op.code = 'numeric'
+    op["type"] = VmNumber[kind]
+    op.order = stage.pattern.order
+    if member ~= nil and member.view then
+      op.into = 'view'
+    elseif member ~= nil and stage.maximum == 1 and member.resolved == kind then
+      op.into = 'scalar'
+    elseif member ~= nil and stage.maximum ~= 1 and member.resolved == 'std::vector<' .. kind .. '>' then
+      op.into = 'vector'
+    elseif stage.ident ~= nil and member == nil and stage.maximum == 1 then
+      op.into = 'scalar'
+      program.locals[#program.locals + 1] = kind .. ' ' .. stage.ident .. ' = 0'
+    elseif stage.ident ~= nil then
+      return nil
+    end
+  elseif stage["type"] == 'Identifier' and TypeMap[stage.pattern] == nil then
+    local kind = stage.pattern
+    op.code = 'rule'
+    if stage.ident == nil then
+      op.call = '&nyx::vm::discard<' .. kind .. '>'
+    elseif member ~= nil and stage.maximum == 1 and member.resolved == kind then
+      op.call = '&nyx::vm::consume<' .. kind .. '>'
+    elseif member ~= nil and stage.maximum ~= 1 and member.resolved == 'std::vector<' .. kind .. '>' then
+      op.call = '&nyx::vm::append<' .. kind .. '>'
+      op.clear = '&nyx::vm::clear<' .. kind .. '>'
+    elseif member == nil and stage.maximum == 1 then
+      op.call = '&nyx::vm::consume<' .. kind .. '>'
+      program.locals[#program.locals + 1] = kind .. ' ' .. stage.ident
+    else
+      return nil
+    end
+  else
+    return nil
+  end
+
+  if stage.ident ~= nil then
+    op.slot = slot(stage.ident)
+  end
+
+  return op
+end
+
+
+-- turns the stages of an alternate into a table of nyx::vm ops, or returns nil
+-- when any of them has no op and the alternate has to stay native
+function compileBytecode(pattern, storage, rule)
+  local stages = pattern
+  if pattern["type"] ~= 'Group' then
+    stages = { pattern }
+  elseif shouldCaptureRawBytes(pattern, storage) then
+    return nil
+  end
+
+  local program = { ops = {}, literals = {}, locals = {}, slots = {} }
+  local index = {}
+  local function slot(name)
+    if index[name] == nil then
+      program.slots[#program.slots + 1] = '&' .. name
+      index[name] = tostring(#program.slots - 1)
+    end
+    return index[name]
+  end
+
+  for i = 1, #stages do
+    local op = compileStage(stages[i], storage, rule, program, slot)
+    if op == nil then
+      return nil
+    end
+    program.ops[#program.ops + 1] = op
+  end
+
+  return program
+end
+
+
+function generateBytecode(code, program)
+  local function opLine(op)
+    return "      { nyx::vm::" .. op.code .. ", nyx::vm::" .. op["type"] ..
+           ", nyx::byte_order::" .. op.order .. ", nyx::vm::" .. op.into .. ", " ..
+           op.mask .. ", " .. op.value .. ", " .. op.slot .. ", " .. op.count ..
+           ", nyx::vm::" .. op.width .. ", " .. op.minimum .. ", " .. op.maximum .. ", " ..
+           op.bytes .. ", " .. op.size .. ", " .. op.call .. ", " .. op.clear .. " },\n"
+  end
+
+  for i = 1, #program.literals do
+    local lit = program.literals[i]
+    code:write("    static const std::uint8_t ", lit.name, "[] = { ", table.concat(lit.bytes, ", "), " };\n")
+  end
+
+  code:write("    static const nyx::vm::op _code__[] = {\n")
+  for i = 1, #program.ops do
+    code:write(opLine(program.ops[i]))
+  end
+  code:write(opLine({ code = 'halt', ["type"] = 'u8', order = 'machine', into = 'none', mask = 0,
+                      value = 0, slot = '-1', count = '-1', width = 'u8', minimum = '0',
+                      maximum = '0', bytes = 'nullptr', size = 0, call = 'nullptr',
+                      clear = 'nullptr' }),
+             "    };\n")
+
+  for i = 1, #program.locals do
+    code:write("    ", program.locals[i], ";\n")
+  end
+
+  local slots = "nullptr"
+  if #program.slots > 0 then
+    code:write("    void *const _slot__[] = { ", table.concat(program.slots, ", "), " };\n")
+    slots = "_slot__"
+  end
+
+  code:write("    _idx__ = nyx::vm::run(_code__, ", slots, ", _raw__, _max__);\n",
+             "    if(_idx__ < 0) {\n",
+             "      break;\n",
+             "    }\n\n")
+end
+
+
+-- program, when given, is the alternate compiled to vm ops
+function generateConsumeAlternate(code, pattern, storage, decode, validate, guard, parallel, program)
+  if guard ~= nil then
+    code:write("  if(", guard, ") do {\n")
+  else
+    code:write("  do {\n")
+  end
+
+  if program ~= nil then
+    generateBytecode(code, program)
+  elseif pattern["type"] == "Group" then
+    local rawBytes = shouldCaptureRawBytes(pattern, storage)
+
+    if rawBytes then
+      code:write("    _start__ = _idx__;\n")
+    end
+
+    if validate ~= nil then
+      local marks = {}
+      local written = collectSexprNames(decode, {})
+      local checks = placeChecks(validate[1], pattern, storage, written, parallel)
+      for _, list in pairs(checks) do
+        for j = 1, #list do
+          list[j] = findSpans(list[j], pattern, storage, written, marks)
+        end
+      end
+      validate = checks.late
+      generateConsumeStages(code, pattern, storage, parallel, marks, checks)
+    else
+      generateConsumeStages(code, pattern, storage, parallel)
+    end
+
+    if rawBytes then
+      -- the input outlives the decode expressions, so they read it in place
+      code:write("    nyx::view ", pattern.ident, "(&_raw__[_start__], _idx__ - _start__);\n")
+    end
+  else
+    generateConsumeStages(code, { pattern, minsize = pattern.minsize }, storage, parallel)
+  end
+
+  if decode ~= nil then
+    for i = 1, #decode do
+      sexprToCpp(code, decode[i])
+      code:write(";\n")
+    end
+    code:write("\n")
+  end
+
+  if validate ~= nil then
+    for i = 1, #validate do
+      generateCheck(code, validate[i])
+    end
+  end
+
+  if Options.streaming then
+    -- an earlier alternate, or a run at the end of the input, may have only
+    -- stopped for want of bytes that have yet to arrive
+    code:write("    if(!_last__ && _need__ > 0) {\n",
+               "      return nyx::failure(_need__);\n",
+               "    }\n")
+  end
+
+  if Counters ~= nil then
+    code:write("    _prof__.hit(", Counters["alternate " .. pattern.source], ");\n")
+  end
+  code:write("    return _idx__;\n")
+  code:write("  } while(false);\n\n")
+end
+
+
+function generateEmitAlternate(code, pattern, storage)
+end
+
+
+-- rules with several alternates look the first input byte up in a table of
+-- the alternates that can start with it, and only try those; alternates
+-- without a first byte set are always tried
+function generateDispatch(code, rule)
+  local alternates = rule.pattern
+  local guards = {}
+  local kind = nil
+  local any = 0
+
+  if #alternates < 2 or #alternates > 64 then
+    return guards
+  end
+
+  for i = 1, #alternates do
+    if alternates[i].first ~= nil then
+      kind = 'std::uint64_t'
+    else
+      any = any | (1 << (i - 1))
+    end
+  end
+
+  if kind == nil then
+    return guards
+  elseif #alternates <= 8 then
+    kind = 'std::uint8_t'
+  elseif #alternates <= 16 then
+    kind = 'std::uint16_t'
+  elseif #alternates <= 32 then
+    kind = 'std::uint32_t'
+  end
+
+  local lookup = {}
+  for byte = 0, 255 do
+    lookup[byte] = any
+  end
+  for i = 1, #alternates do
+    local first = alternates[i].first
+    if first ~= nil then
+      for j = 1, #first do
+        lookup[first[j]] = lookup[first[j]] | (1 << (i - 1))
+      end
+    end
+  end
+
+  code:write("  static const ", kind, " _first__[256] = {\n")
+  for byte = 0, 255 do
+    if byte % 16 == 0 then
+      code:write("    ")
+    end
+    code:write(string.format("0x%X", lookup[byte]))
+    if byte == 255 then
+      code:write("\n")
+    elseif byte % 16 == 15 then
+      code:write(",\n")
+    else
+      code:write(", ")
+    end
+  end
+  code:write("  };\n",
+             "  const ", kind, " _cand__ = _max__ > 0 ? _first__[_raw__[0]] : ",
+             string.format("0x%X", any), ";\n\n")
+
+  for i = 1, #alternates do
+    guards[i] = string.format("_cand__ & 0x%X", 1 << (i - 1))
+  end
+
+  return guards
+end
+
+
+-- name of the operator a Sexpr node applies, nil for anything else
+function sexprOp(node)
+  if node == nil or node["type"] ~= 'Sexpr' then
+    return nil
+  elseif node.value["type"] == 'Identifier' then
+    return table.concat(node.value.value, '.')
+  end
+
+  return node.value.value
+end
+
+
+function sexprName(node)
+  if node ~= nil and node["type"] == 'Identifier' then
+    return table.concat(node.value, '.')
+  end
+
+  return nil
+end
+
+
+function sexprNumber(node)
+  if node ~= nil and (node["type"] == 'DecimalLiteral' or node["type"] == 'HexadecimalLiteral') then
+    return tonumber(node.value)
+  end
+
+  return nil
+end
+
+
+-- strips a numeric cast such as (u64 x) down to x
+function sexprUncast(node)
+  local op = sexprOp(node)
+
+  if op ~= nil and TypeMap[op] ~= nil and #node == 1 then
+    return node[1]
+  end
+
+  return node
+end
+
+
+-- true when node is the binary op applied to operands matching first and
+-- second in either order
+function sexprPair(node, op, first, second)
+  if sexprOp(node) ~= op or #node ~= 2 then
+    return false
+  end
+
+  return (first(node[1]) and second(node[2])) or (first(node[2]) and second(node[1]))
+end
+
+
+-- spots the continuation bit varint idiom
+--   pattern: (0b1*******{0,n} 0b0*******)=>raw
+--   decode:  ((= val (u64 0))
+--             (sequence raw (lambda (byte index length)
+--               (= val (| val (<< (u64 (& byte 0x7F)) (* 7 index)))))))
+-- and returns the member the value lands in and the longest encoding
+function findVarint(rule, storage)
+  if #rule.pattern ~= 1 or rule.decode == nil or #rule.decode ~= 2 or rule.validate ~= nil then
+    return nil
+  end
+
+  local group = rule.pattern[1]
+  if group["type"] ~= 'Group' or #group ~= 2 or group.minimum ~= 1 or group.maximum ~= 1 or
+     not shouldCaptureRawBytes(group, storage) then
+    return nil
+  end
+
+  local more, last = group[1], group[2]
+  if more["type"] ~= 'PatternMatch' or more.ident ~= nil or more.pattern.mask ~= 128 or
+     more.pattern.value ~= 128 or more.minimum ~= 0 or type(more.maximum) ~= 'number' or
+     more.maximum < 0 or more.maximum > 9 then
+    return nil
+  end
+  if last["type"] ~= 'PatternMatch' or last.ident ~= nil or last.pattern.mask ~= 128 or
+     last.pattern.value ~= 0 or last.minimum ~= 1 or last.maximum ~= 1 then
+    return nil
+  end
+
+  local init, walk = rule.decode[1], rule.decode[2]
+  local target = sexprName(init[1])
+  if sexprOp(init) ~= '=' or target == nil or storage[target] == nil or
+     sexprNumber(sexprUncast(init[2])) ~= 0 then
+    return nil
+  end
+
+  local lambda = walk[2]
+  if sexprOp(walk) ~= 'sequence' or #walk ~= 2 or sexprName(walk[1]) ~= group.ident or
+     sexprOp(lambda) ~= 'lambda' or #lambda ~= 2 or #lambda[1] < 1 then
+    return nil
+  end
+
+  local byte = lambda[1].value.value[1]
+  local index = lambda[1][1].value[1]
+  local function is(name)
+    return function(node) return sexprName(node) == name end
+  end
+  local function equals(val)
+    return function(node) return sexprNumber(node) == val end
+  end
+  local function bits(node)
+    return sexprPair(sexprUncast(node), '&', is(byte), equals(127))
+  end
+  local function shift(node)
+    node = sexprUncast(node)
+    return sexprOp(node) == '<<' and #node == 2 and bits(node[1]) and
+           sexprPair(node[2], '*', equals(7), is(index))
+  end
+
+  local body = lambda[2]
+  if sexprOp(body) ~= '=' or sexprName(body[1]) ~= target or
+     not sexprPair(body[2], '|', is(target), shift) then
+    return nil
+  end
+
+  return { target = target, limit = more.maximum + 1 }
+end
+
+
+-- the varint idiom decodes straight from the input, with no raw capture and
+-- no per byte walk over it
+function generateVarint(code, rule, varint)
+  code:write(Inline, "std::ssize_t ", rule.name,
+             "::consume(const std::uint8_t *_raw__, std::size_t _max__", Options.streaming and ", bool" or "", ") {\n",
+             "  std::uint64_t _tmp__;\n",
+             "  auto _idx__ = nyx::varint(_raw__, _max__, ", varint.limit, ", _tmp__);\n\n")
+  if Options.streaming then
+    code:write("  if(_idx__ == 0) {\n",
+               "    return nyx::failure(1);\n",
+               "  }\n")
+  end
+  code:write("  if(_idx__ <= 0) {\n",
+             "    return -1;\n",
+             "  }\n\n",
+             "  ", varint.target, " = _tmp__;\n",
+             "  return _idx__;\n",
+             "}\n\n\n")
+end
+
+
+-- copy of a stage that only matches: values nothing depends on are dropped,
+-- sub-rules are skipped rather than decoded, and counts held by sub-rules are
+-- read through their val member as they would be from storage
+function skipStage(stage, refs, root)
+  local copy = {}
+
+  for key, val in pairs(stage) do
+    copy[key] = val
+  end
+  if stage["type"] == 'Group' then
+    for i = 1, #stage do
+      copy[i] = skipStage(stage[i], refs, root)
+    end
+  end
+
+  if copy.ident ~= nil and (not refs[copy.ident] or copy["type"] == 'Group' or copy["type"] == 'Select') then
+    copy.ident = nil
+  end
+  if copy.ident == nil and (copy["type"] == 'Identifier' or copy["type"] == 'Select') then
+    copy.skip = true
+  end
+
+  for _, bound in ipairs({ 'minimum', 'maximum' }) do
+    if type(copy[bound]) == 'string' then
+      local counter = findStage(copy[bound], root)
+      if counter ~= nil and counter["type"] == 'Identifier' and TypeMap[counter.pattern] == nil then
+        copy[bound] = copy[bound] .. '.val'
+      end
+    end
+  end
+
+  return copy
+end
+
+
+-- skip() matches a rule without keeping anything or running its code, and
+-- returns how many bytes it covers; lazy members and parallel decoding use it
+-- to find where elements end
+function generateSkip(code, rule, storage)
+  code:write(Inline, "std::ssize_t ", rule.name,
+             "::skip(const std::uint8_t *_raw__, std::size_t _max__) {\n")
+
+  local varint = findVarint(rule, storage)
+  if varint ~= nil then
+    code:write("  std::uint64_t _tmp__;\n",
+               "  auto _idx__ = nyx::varint(_raw__, _max__, ", varint.limit, ", _tmp__);\n",
+               "  return _idx__ > 0 ? _idx__ : -1;\n",
+               "}\n\n\n")
+    return
+  end
+
+  local refs = collectReferences(rule.pattern, {})
+  local alternates = {}
+  local loops = false
+  for i = 1, #rule.pattern do
+    alternates[i] = skipStage(rule.pattern[i], refs, { rule.pattern[i] })
+    loops = loops or hasRepeatLoop(alternates[i], {})
+  end
+
+  if loops then
+    code:write("  int _rep__;\n")
+  end
+  code:write("  std::ssize_t _idx__ = 0;\n")
+  if Options.streaming then
+    code:write("  std::size_t _need__ = 0;\n",
+               "  const bool _last__ = true;\n")
+  end
+  code:write("\n")
+
+  if #rule.pattern > 1 and rule.minsize > 0 then
+    code:write("  if(_max__ < ", rule.minsize, ") {\n",
+               "    return -1;\n",
+               "  }\n\n")
+  end
+
+  local guards = generateDispatch(code, rule)
+
+  for i = 1, #rule.pattern do
+    generateConsumeAlternate(code, alternates[i], {}, nil, nil, guards[i])
+    if i ~= #rule.pattern then
+      code:write("  _idx__ = 0;\n\n")
+    end
+  end
+  code:write("  return -1;\n}\n\n\n");
+end
+
+
+-- a rule can stop between any two elements of its stages when it has a single
+-- alternate and everything matched so far lives in storage rather than locals
+function isResumable(rule, storage)
+  if #rule.pattern ~= 1 then
+    return false
+  end
+
+  local pattern = rule.pattern[1]
+  local stages = { pattern }
+  if pattern["type"] == 'Group' then
+    if shouldCaptureRawBytes(pattern, storage) then
+      return false
+    end
+    stages = pattern
+  end
+
+  for i = 1, #stages do
+    if stages[i]["type"] == 'Group' or
+       (stages[i].ident ~= nil and storage[stages[i].ident] == nil) then
+      return false
+    end
+  end
+
+  return true
+end
+
+
+-- when the next element does not fit in the input either ask for the missing
+-- bytes or, at the end of the input, leave the loop
+function generateSuspend(code, bytes, indent)
+  code:write(indent, "if(_max__ - _idx__ < ", bytes, ") {\n",
+             indent, "  if(!_last__) {\n",
+             indent, "    return nyx::status::starved(_idx__, ", bytes, " - (_max__ - _idx__));\n",
+             indent, "  }\n",
+             indent, "  break;\n",
+             indent, "}\n")
+end
+
+
+-- a nested rule is consumed whole, so a short one is retried from its start
+function generateResumeResult(code, consume, undo, indent)
+  code:write(indent, "auto result = ", consume, callArgs(consume), ";\n")
+  generateResumeCheck(code, undo, indent)
+end
+
+
+function generateResumeCheck(code, undo, indent)
+  code:write(indent, "if(result < 0) {\n")
+  if undo ~= nil then
+    code:write(indent, "  ", undo, ";\n")
+  end
+  code:write(indent, "  if(!_last__ && result < -1) {\n",
+             indent, "    return nyx::status::starved(_idx__, nyx::shortfall(result));\n",
+             indent, "  }\n",
+             indent, "  break;\n",
+             indent, "}\n",
+             indent, "_idx__ += result;\n")
+end
+
+
+-- one case of the resume state machine; _cur__.rep counts the elements of the
+-- stage that have been decoded so far
+function generateResumeStage(code, stage, storage, index)
+  code:write("  case ", index, ":\n")
+
+  if stage.ident ~= nil then
+    local raw = storage[stage.ident].raw
+    if #raw == 1 and (raw[1] == 'string' or raw[1] == 'vector') then
+      code:write("    if(_cur__.rep == 0) {\n",
+                 "      ", stage.ident, ".clear();\n")
+      if type(stage.maximum) == 'string' or stage.maximum > 1 then
+        -- counting ahead needs the whole run, so only known counts are reserved
+        generateReserve(code, stage, storage, "      ")
+      end
+      code:write("    }\n")
+    elseif #raw == 1 and stage["type"] == 'Numeric' then
+      code:write("    ", stage.ident, " = 0;\n")
+    end
+  end
+
+  if isBulkNumeric(stage, storage) then
+    generateBulkNumeric(code, stage, storage, false, true)
+  else
+    if type(stage.maximum) == "number" and stage.maximum > 0 then
+      code:write("    for(; _cur__.rep < ", stage.maximum, "; ++_cur__.rep) {\n")
+    elseif type(stage.maximum) == "string" then
+      code:write("    for(; _cur__.rep < ", repeatCount(stage.maximum, storage), "; ++_cur__.rep) {\n")
+    else
+      code:write("    for(; true; ++_cur__.rep) {\n")
+    end
+
+    if stage["type"] == 'ExactMatch' then
+      local arr = stage.pattern
+      generateSuspend(code, #arr, "      ")
+      code:write("      if(")
+      for i = 1, #arr - 1, 1 do
+        code:write("_raw__[_idx__ + ", i - 1, "] != ", arr[i], " ||\n         ")
+      end
+      code:write("_raw__[_idx__ + ", #arr - 1, "] != ", arr[#arr], ") {\n",
+                 "        break;\n",
+                 "      }\n",
+                 "      _idx__ += ", #arr, ";\n")
+    elseif stage["type"] == 'PatternMatch' then
+      local pat = stage.pattern
+      generateSuspend(code, 1, "      ")
+      code:write("      if((_raw__[_idx__] & ", pat.mask, ") != ", pat.value, ") {\n",
+                 "        break;\n",
+                 "      }\n")
+      if stage.ident ~= nil then
+        if stage.maximum ~= 1 then
+          code:write("      ", stage.ident, ".append(1, static_cast<char>(_raw__[_idx__]));\n")
+        else
+          code:write("      ", stage.ident, " = _raw__[_idx__];\n")
+        end
+      end
+      code:write("      ++_idx__;\n")
+    elseif stage["type"] == 'Numeric' then
+      generateSuspend(code, stage.pattern.size, "      ")
+      if stage.ident ~= nil then
+        generateNumericValue(code, stage, "      ")
+      end
+      code:write("      _idx__ += ", stage.pattern.size, ";\n")
+    elseif stage["type"] == 'Identifier' then
+      if stage.ident == nil then
+        code:write("      ", stage.pattern, " _tmp__;\n")
+        generateResumeResult(code, "_tmp__.consume", nil, "      ")
+      elseif isColumnar(stage, storage) then
+        generateResumeResult(code, stage.ident .. ".append", nil, "      ")
+      elseif stage.maximum ~= 1 then
+        code:write("      ", stage.ident, ".emplace_back();\n")
+        generateResumeResult(code, stage.ident .. ".back().consume", stage.ident .. ".pop_back()", "      ")
+      else
+        generateResumeResult(code, stage.ident .. ".consume", nil, "      ")
+      end
+    elseif stage["type"] == 'Select' then
+      generateSelect(code, stage, "      ", false, function(kind)
+        return stage.ident .. (Options.recycle and ".reuse<" or ".emplace<") .. kind .. ">().consume"
+      end)
+      generateResumeCheck(code, nil, "      ")
+    end
+
+    code:write("    }\n")
+    if type(stage.minimum) == "number" and stage.minimum > 0 then
+      code:write("    if(_cur__.rep < ", stage.minimum, ") {\n",
+                 "      break;\n",
+                 "    }\n")
+    elseif type(stage.minimum) == 'string' then
+      code:write("    if(_cur__.rep < ", repeatCount(stage.minimum, storage), ") {\n",
+                 "      break;\n",
+                 "    }\n")
+    end
   end
 
-  code:write("    }\n")
-  if type(stage.minimum) == "number" and stage.minimum > 0 then
-    code:write("    if(_rep__ < ", stage.minimum, ") {\n")
-    code:write("      break;\n")
-    code:write("    }\n")
-	elseif type(stage.minimum) == 'string' then
-    local kind = storage[stage.maximum]
+  code:write("    _cur__.stage = ", index + 1, ";\n",
+             "    _cur__.rep = 0;\n",
+             "    // fall through\n\n")
+end
 
-    if kind == nil or TypeMap[kind.resolved] ~= nil then
-      code:write("    if(_rep__ < ", stage.minimum, ") {\n")
-    else
-      code:write("    if(_rep__ < ", stage.minimum, ".val) {\n")
+
+-- resume() picks a decode up where the previous call left off; a break out of
+-- the switch means the input does not match the rule
+function generateResume(code, rule, storage)
+  local resumable = isResumable(rule, storage)
+
+  -- a rule decoded whole keeps no place in the cursor
+  code:write(Inline, "nyx::status ", rule.name,
+             "::resume(nyx::cursor &", resumable and "_cur__" or "",
+             ", const std::uint8_t *_raw__, std::size_t _max__, bool _last__) {\n")
+
+  if not resumable then
+    -- decoded whole once enough of the input is available
+    code:write("  auto result = consume(_raw__, _max__, _last__);\n",
+               "  if(result >= 0) {\n",
+               "    return nyx::status::complete(result);\n",
+               "  }\n",
+               "  else if(!_last__ && result < -1) {\n",
+               "    return nyx::status::starved(0, nyx::shortfall(result));\n",
+               "  }\n\n",
+               "  return nyx::status::failure(0);\n",
+               "}\n\n\n")
+    return
+  end
+
+  local pattern = rule.pattern[1]
+  local stages = pattern["type"] == 'Group' and pattern or { pattern }
+
+  code:write("  std::ssize_t _idx__ = 0;\n\n",
+             "  switch(_cur__.stage) {\n")
+
+  for i = 1, #stages do
+    generateResumeStage(code, stages[i], storage, i - 1)
+  end
+
+  code:write("  case ", #stages, ":\n")
+  if rule.decode ~= nil then
+    for i = 1, #rule.decode do
+      sexprToCpp(code, rule.decode[i])
+      code:write(";\n")
     end
-    code:write("      break;\n")
-    code:write("    }\n")
+    code:write("\n")
   end
-  code:write("\n")
+
+  if rule.validate ~= nil then
+    generateCheck(code, rule.validate[1])
+  end
+
+  code:write("    _cur__ = nyx::cursor();\n",
+             "    return nyx::status::complete(_idx__);\n",
+             "  }\n\n",
+             "  _cur__ = nyx::cursor();\n",
+             "  return nyx::status::failure(_idx__);\n",
+             "}\n\n\n")
 end
 
 
-function shouldCaptureRawBytes(pattern, storage)
-  if pattern.ident ~= nil and storage[pattern.ident] == nil then
-    return true
+function caseLabel(stage, key)
+  return "case " .. (stage.ident or stage.pattern.reference) .. " " .. key
+end
+
+
+-- the stages of an alternate, which is either a group of them or just one
+function alternateStages(alternate)
+  if alternate["type"] == 'Group' then
+    return alternate
   end
 
-  return false
+  return { alternate }
 end
 
-function generateConsumeAlternate(code, pattern, storage, decode, validate, final)
-  code:write("  do {\n")
 
-  if pattern["type"] == "Group" then
-    local rawBytes = shouldCaptureRawBytes(pattern, storage)
+-- true when no input can start both alternates
+function isDisjoint(one, two)
+  if one.first == nil or two.first == nil then
+    return false
+  end
 
-    if rawBytes then
-      code:write("    _start__ = _idx__;\n")
+  local seen = {}
+  for i = 1, #one.first do
+    seen[one.first[i]] = true
+  end
+  for i = 1, #two.first do
+    if seen[two.first[i]] then
+      return false
     end
+  end
 
-    for i = 1, #pattern, 1 do
-      generateConsumeStage(code, pattern[i], storage, decode)
-    end
+  return true
+end
 
-    if rawBytes then
-      code:write("    std::vector<std::uint8_t> ", pattern.ident,
-                      "(&_raw__[_start__], &_raw__[_idx__]);\n")
-    end
-  else
-    generateConsumeStage(code, pattern, storage, decode)
+
+-- puts the alternates and @match cases a profile saw most often first, as far
+-- as that cannot change what matches: an alternate only moves ahead of ones
+-- that share none of its first bytes, and the cases test distinct keys
+function applyProfile(rule)
+  for i = 1, #rule.pattern do
+    rule.pattern[i].source = rule.pattern[i].source or i
   end
 
-  if decode ~= nil then
-    for i = 1, #decode do
-      sexprToCpp(code, decode[i])
-      code:write(";\n")
-    end
-    code:write("\n")
+  local hits = Profile[rule.id]
+  if hits == nil then
+    return
   end
 
-  if validate ~= nil then
-    code:write("    if(!(")
-    sexprToCpp(code, validate[1])
-    code:write(")) {\n",
-               "      break;\n",
-               "    }\n\n")
+  local function count(label)
+    return hits[label] or 0
   end
 
-  code:write("    return _idx__;\n")
-  code:write("  } while(false);\n\n")
+  local order = {}
+  for i = 1, #rule.pattern do
+    local alternate = rule.pattern[i]
+    local heat = count("alternate " .. alternate.source)
+    local pos = #order + 1
+
+    while pos > 1 and count("alternate " .. order[pos - 1].source) < heat and
+          isDisjoint(order[pos - 1], alternate) do
+      pos = pos - 1
+    end
+    table.insert(order, pos, alternate)
+  end
+  for i = 1, #order do
+    rule.pattern[i] = order[i]
+  end
+
+  for i = 1, #rule.pattern do
+    local stages = alternateStages(rule.pattern[i])
+
+    for j = 1, #stages do
+      local stage = stages[j]
+
+      if stage["type"] == 'Select' then
+        local keys = {}
+        local place = {}
+        for k = 1, #stage.pattern.keys do
+          keys[k] = stage.pattern.keys[k]
+          place[keys[k]] = k
+        end
+
+        table.sort(keys, function(one, two)
+          local diff = count(caseLabel(stage, one)) - count(caseLabel(stage, two))
+          if diff ~= 0 then
+            return diff > 0
+          end
+          return place[one] < place[two]
+        end)
+        stage.pattern.keys = keys
+      end
+    end
+  end
 end
 
 
-function generateEmitAlternate(code, pattern, storage)
+-- declares the counters of an instrumented consume and notes which of them
+-- each alternate and case bumps
+function generateCounters(code, rule)
+  local labels = {}
+
+  for i = 1, #rule.pattern do
+    local alternate = rule.pattern[i]
+    labels[#labels + 1] = "alternate " .. alternate.source
+
+    local stages = alternateStages(alternate)
+    for j = 1, #stages do
+      if stages[j]["type"] == 'Select' then
+        local cases = selectCases(stages[j])
+        for k = 1, #cases do
+          labels[#labels + 1] = cases[k].label
+        end
+      end
+    end
+  end
+  labels[#labels + 1] = "failed"
+
+  Counters = {}
+  for i = 1, #labels do
+    Counters[labels[i]] = i - 1
+  end
+
+  code:write("  static nyx::profile::counters _prof__(\"", rule.id, "\", {\n",
+             "    \"", table.concat(labels, "\",\n    \""), "\"\n",
+             "  });\n")
 end
 
 
 function generateRuleClass(header, code, rule, ns)
+  rule.id = table.concat(ns, '.') .. '.' .. rule.name
+  applyProfile(rule)
+
   header:write("class ", rule.name, "{\n",
                "  public:\n",
-               "    std::ssize_t consume(const std::uint8_t *, std::size_t);\n",
-               "    std::size_t size() const;\n",
-               "    std::ssize_t emit(std::uint8_t *, std::size_t) const;\n")
+               "    std::ssize_t consume(const std::uint8_t *, std::size_t", Options.streaming and ", bool = true" or "", ");\n")
+  if Options.streaming then
+    header:write("    nyx::status resume(nyx::cursor &, const std::uint8_t *, std::size_t, bool);\n")
+  end
+  local parallel = hasParallel(rule)
+  if parallel then
+    header:write("    std::ssize_t consume(const std::uint8_t *, std::size_t, nyx::workers &);\n")
+  end
+  if Options.lazy or Options.parallel or Options.twopass then
+    header:write("    static std::ssize_t skip(const std::uint8_t *, std::size_t);\n")
+  end
+  if Scanner[rule.name] then
+    rule.prefixes = rulePrefixes(rule)
+    if rule.prefixes == nil then
+      io.write("Rule '", rule.name, "' does not always start with fixed bytes, it cannot be scanned for\n")
+    else
+      header:write("    std::ssize_t seek(const std::uint8_t *, std::size_t, std::size_t &);\n")
+    end
+  end
+  header:write("    std::size_t size() const;\n",
+               "    std::ssize_t emit(std::uint8_t *, std::size_t) const;\n",
+               "    void reset();\n")
+  if Options.layout then
+    header:write("    static void layout(std::ostream &);\n")
+  end
+  if Options.recycle then
+    -- what nyx::object_pool checks for
+    header:write("    static constexpr bool recycled = true;\n")
+  end
   local storage = {}
   if rule.storage ~= nil then
-    storage = generateRuleStorage(header, rule.storage, rule.pattern)
+    storage = generateRuleStorage(header, rule.storage, rule.pattern, rule)
+  else
+    Layouts[rule.name] = structLayout({})
   end
   header:write("};\n\n\n")
 
+  if Columnar[rule.name] then
+    generateBatch(header, code, rule, storage)
+  end
+
   local namespace = table.concat(ns, '::')
 
-  code:write("std::ssize_t ", rule.name,
-             "::consume(const std::uint8_t *_raw__, std::size_t _max__) {\n",
-             "  int _rep__;\n",
-             "  std::ssize_t _idx__ = 0;\n")
-  if rule.decode ~= nil then
-    code:write("  std::ssize_t _start__;\n")
+  local varint = findVarint(rule, storage)
+  if varint ~= nil then
+    generateVarint(code, rule, varint)
+  else
+    generateConsume(code, rule, storage)
   end
-  code:write("\n")
 
-  for i = 1, #rule.pattern - 1, 1 do
-    generateConsumeAlternate(code, rule.pattern[i], storage, rule.decode, rule.validate)
+  if parallel then
+    generateConsume(code, rule, storage, true)
   end
-  generateConsumeAlternate(code, rule.pattern[#rule.pattern], storage, rule.decode, rule.validate)
-  code:write("  return -1;\n}\n\n\n");
 
-  code:write("std::size_t ", rule.name, "::size() const {\n")
+  if Options.streaming then
+    generateResume(code, rule, storage)
+  end
+
+  if Options.lazy or Options.parallel or Options.twopass then
+    generateSkip(code, rule, storage)
+  end
+
+  if rule.prefixes ~= nil then
+    generateSeek(code, rule)
+  end
+
+  generateReset(code, rule, storage)
+
+  if Options.layout then
+    generateLayout(code, rule)
+  end
+
+  code:write(Inline, "std::size_t ", rule.name, "::size() const {\n")
   code:write("  return 0;\n}\n\n\n");
 
-  code:write("std::ssize_t ", rule.name,
+  code:write(Inline, "std::ssize_t ", rule.name,
              "::emit(std::uint8_t *_raw__, std::size_t _max__) const {\n")
   for i = 1, #rule.pattern do
     generateEmitAlternate(code, rule.pattern[i], storage)
@@ -544,9 +2567,454 @@ function generateRuleClass(header, code, rule, ns)
 end
 
 
+-- the batch of a columnar rule decodes each record into a scratch instance,
+-- whose strings and vectors keep their capacity from one record to the next,
+-- and appends its members to the columns; offsets hold one more entry than
+-- there are records so that record i spans [offsets[i], offsets[i + 1])
+function generateBatch(header, code, rule, storage)
+  local batch = rule.name .. '_batch'
+  local container = Options.arena and 'nyx::arena_vector<' or 'std::vector<'
+  local columns = {}
+
+  for i = 1, #(rule.storage or {}) do
+    local name = rule.storage[i].name
+    local kind = storage[name].resolved
+    local column = { name = name }
+
+    if type(kind) == 'table' then
+      column.kind = container .. 'nyx::choice<' .. table.concat(selectKinds(kind), ', ') .. '>>'
+      column.moved = true
+    elseif kind == 'std::string' or kind == 'nyx::arena_string' then
+      column.kind = kind
+      column.packed = true
+    elseif string.match(kind, '^std::vector<') or string.match(kind, '^nyx::arena_vector<') then
+      column.kind = container .. string.match(kind, '^[^<]+<(.*)>$') .. '>'
+      column.packed = true
+    else
+      column.kind = container .. kind .. '>'
+      column.moved = Layouts[kind] == nil
+    end
+
+    columns[#columns + 1] = column
+  end
+
+  header:write("class ", batch, "{\n",
+               "  public:\n",
+               "    ", batch, "();\n\n",
+               "    std::ssize_t consume(const std::uint8_t *, std::size_t);\n",
+               "    std::ssize_t append(const std::uint8_t *, std::size_t);\n",
+               "    std::size_t size() const;\n",
+               "    void reserve(std::size_t);\n",
+               "    void clear();\n\n\n")
+  for i = 1, #columns do
+    header:write("    ", columns[i].kind, " ", columns[i].name, ";\n")
+    if columns[i].packed then
+      header:write("    ", container, "std::size_t> ", columns[i].name, "_offsets;\n")
+    end
+  end
+  header:write("\n",
+               "  private:\n",
+               "    ", rule.name, " _rec__;\n",
+               "    std::size_t _rows__;\n",
+               "};\n\n\n")
+
+  code:write(Inline, rule.name, "_batch::", batch, "(): _rows__(0) {\n")
+  for i = 1, #columns do
+    if columns[i].packed then
+      code:write("  ", columns[i].name, "_offsets.push_back(0);\n")
+    end
+  end
+  code:write("}\n\n\n")
+
+  code:write(Inline, "std::ssize_t ", batch, "::consume(const std::uint8_t *_raw__, std::size_t _max__) {\n",
+             "  std::size_t _idx__ = 0;\n\n",
+             "  clear();\n",
+             "  for(std::ssize_t result; _idx__ < _max__ && (result = append(&_raw__[_idx__], _max__ - _idx__)) > 0;) {\n",
+             "    _idx__ += result;\n",
+             "  }\n\n",
+             "  return _idx__;\n",
+             "}\n\n\n")
+
+  code:write(Inline, "std::ssize_t ", batch, "::append(const std::uint8_t *_raw__, std::size_t _max__) {\n",
+             "  auto result = _rec__.consume(_raw__, _max__);\n",
+             "  if(result < 0) {\n",
+             "    return result;\n",
+             "  }\n\n")
+  for i = 1, #columns do
+    local name = columns[i].name
+    if columns[i].packed then
+      code:write("  ", name, ".insert(", name, ".end(), _rec__.", name, ".begin(), _rec__.", name, ".end());\n",
+                 "  ", name, "_offsets.push_back(", name, ".size());\n")
+    elseif columns[i].moved then
+      code:write("  ", name, ".push_back(std::move(_rec__.", name, "));\n")
+    else
+      code:write("  ", name, ".push_back(_rec__.", name, ");\n")
+    end
+  end
+  code:write("  ++_rows__;\n\n",
+             "  return result;\n",
+             "}\n\n\n")
+
+  code:write(Inline, "std::size_t ", batch, "::size() const {\n",
+             "  return _rows__;\n",
+             "}\n\n\n")
+
+  code:write(Inline, "void ", batch, "::reserve(std::size_t count) {\n")
+  for i = 1, #columns do
+    if columns[i].packed then
+      code:write("  ", columns[i].name, "_offsets.reserve(count + 1);\n")
+    else
+      code:write("  ", columns[i].name, ".reserve(count);\n")
+    end
+  end
+  code:write("}\n\n\n")
+
+  code:write(Inline, "void ", batch, "::clear() {\n")
+  for i = 1, #columns do
+    code:write("  ", columns[i].name, ".clear();\n")
+    if columns[i].packed then
+      code:write("  ", columns[i].name, "_offsets.assign(1, 0);\n")
+    end
+  end
+  code:write("  _rows__ = 0;\n",
+             "}\n\n\n")
+end
+
+
+-- the bytes every match of the stages starts with, and whether the stages
+-- match nothing but those bytes; sub-rules of the namespace are looked into
+-- when they have a single alternate
+function leadingBytes(stages)
+  local bytes = {}
+
+  for i = 1, #stages do
+    local stage = stages[i]
+    local each, whole
+
+    if type(stage.maximum) ~= 'number' or stage.maximum < 1 or stage.minimum ~= stage.maximum then
+      return bytes, false
+    elseif stage["type"] == 'ExactMatch' then
+      each, whole = stage.pattern, true
+    elseif stage["type"] == 'Group' then
+      each, whole = leadingBytes(stage)
+    elseif stage["type"] == 'Identifier' and Rules[stage.pattern] ~= nil and #Rules[stage.pattern].pattern == 1 then
+      local pattern = Rules[stage.pattern].pattern[1]
+      each, whole = leadingBytes(pattern["type"] == 'Group' and pattern or { pattern })
+    else
+      return bytes, false
+    end
+
+    for rep = 1, whole and stage.maximum or 1 do
+      for j = 1, #each do
+        bytes[#bytes + 1] = each[j]
+      end
+    end
+
+    if not whole then
+      return bytes, false
+    end
+  end
+
+  return bytes, true
+end
+
+
+-- the fixed bytes each alternate of a rule starts with, or nil when one of
+-- them has none and the rule could start with anything
+function rulePrefixes(rule)
+  local prefixes = {}
+
+  for i = 1, #rule.pattern do
+    local pattern = rule.pattern[i]
+    local bytes = leadingBytes(pattern["type"] == 'Group' and pattern or { pattern })
+
+    if #bytes == 0 then
+      return nil
+    end
+    prefixes[#prefixes + 1] = bytes
+  end
+
+  return prefixes
+end
+
+
+-- the nyx::prefixes a seek() searches with, built once from static tables
+function generatePrefixes(code, prefixes)
+  for i = 1, #prefixes do
+    code:write("  static const std::uint8_t _prefix", i - 1, "__[] = { ", table.concat(prefixes[i], ", "), " };\n")
+  end
+
+  code:write("  static const nyx::view _prefixes__[] = {\n")
+  for i = 1, #prefixes do
+    code:write("    nyx::view(_prefix", i - 1, "__, ", #prefixes[i], ")", i < #prefixes and ",\n" or "\n")
+  end
+  code:write("  };\n",
+             "  static const nyx::prefixes _find__(_prefixes__, ", #prefixes, ");\n\n")
+end
+
+
+-- seek() decodes the first instance of the rule at or after the offset it is
+-- handed, leaving the offset where that instance starts
+function generateSeek(code, rule)
+  code:write(Inline, "std::ssize_t ", rule.name,
+             "::seek(const std::uint8_t *_raw__, std::size_t _max__, std::size_t &_at__) {\n")
+  generatePrefixes(code, rule.prefixes)
+
+  code:write("  for(std::size_t _which__; (_at__ = _find__.find(_raw__, _max__, _at__, _which__)) < _max__; ++_at__) {\n",
+             "    auto result = consume(&_raw__[_at__], _max__ - _at__);\n",
+             "    if(result >= 0) {\n",
+             "      return result;\n",
+             "    }\n",
+             "  }\n\n",
+             "  return -1;\n}\n\n\n")
+end
+
+
+-- the namespace seek() looks for every scanned rule in one pass and reports
+-- which of them it found by its place among them, in schema order; the
+-- instance is only checked, so it has to be decoded again to be kept
+function generateNamespaceSeek(header, code, rules, ns)
+  local prefixes = {}
+  local first = {}
+
+  for i = 1, #rules do
+    first[i] = #prefixes
+    for j = 1, #rules[i].prefixes do
+      prefixes[#prefixes + 1] = rules[i].prefixes[j]
+    end
+  end
+  first[#rules + 1] = #prefixes
+
+  header:write("std::ssize_t seek(const std::uint8_t *, std::size_t, std::size_t &, int &);\n\n\n")
+
+  -- header only code is written inside the namespace, the .cpp is not
+  local name = Options['header-only'] and 'seek' or table.concat(ns, '::') .. '::seek'
+  code:write(Inline, "std::ssize_t ", name,
+             "(const std::uint8_t *_raw__, std::size_t _max__, std::size_t &_at__, int &_rule__) {\n")
+  generatePrefixes(code, prefixes)
+
+  code:write("  for(std::size_t _which__; (_at__ = _find__.find(_raw__, _max__, _at__, _which__)) < _max__; ++_at__) {\n",
+             "    auto _here__ = &_raw__[_at__];\n",
+             "    auto _left__ = _max__ - _at__;\n",
+             "    std::ssize_t result;\n\n")
+
+  for i = 1, #rules do
+    local starts = {}
+    for j = first[i], first[i + 1] - 1 do
+      starts[#starts + 1] = "_find__.starts(_here__, _left__, " .. j .. ")"
+    end
+
+    code:write("    if((", table.concat(starts, " ||\n        "), ") &&\n",
+               "       (result = ", rules[i].name, "().consume(_here__, _left__)) >= 0) {\n",
+               "      _rule__ = ", i - 1, ";\n",
+               "      return result;\n",
+               "    }\n")
+  end
+
+  code:write("  }\n\n",
+             "  return -1;\n}\n\n\n")
+end
+
+
+-- layout() reports the size the compiler gave the class, and that of the same
+-- members declared in storage order
+function generateLayout(code, rule)
+  code:write(Inline, "void ", rule.name, "::layout(std::ostream &_out__) {\n",
+             "  struct _order__ {\n")
+  for i = 1, #(rule.declared or {}) do
+    code:write("    ", rule.declared[i], ";\n")
+  end
+  code:write("  };\n\n",
+             "  _out__ << \"", rule.id, " is \" << sizeof(", rule.name, ") << \" bytes, \" <<\n",
+             "          sizeof(_order__) << \" in storage order\\n\";\n",
+             "}\n\n\n")
+end
+
+
+-- reset() empties an object for another decode: containers are cleared rather
+-- than freed and nested rules reset in turn. Only with recycle does that reach
+-- all the way down, otherwise vectors of sub-rules and @match destroy what
+-- they held
+function generateReset(code, rule, storage)
+  code:write(Inline, "void ", rule.name, "::reset() {\n")
+
+  for i = 1, #(rule.storage or {}) do
+    local name = rule.storage[i].name
+    local member = storage[name]
+    local kind = member.resolved
+
+    if type(kind) == 'table' then
+      code:write("  ", name, Options.recycle and ".park();\n" or ".clear();\n")
+    elseif isNativeType(kind) and kind ~= 'std::string' then
+      code:write("  ", name, " = 0;\n")
+    elseif string.match(kind, '^nyx::lazy<') then
+      code:write("  ", name, ".reset();\n")
+    elseif member.view or member.columnar or (#member.raw == 1 and
+           (member.raw[1] == 'string' or member.raw[1] == 'vector')) then
+      code:write("  ", name, ".clear();\n")
+    else
+      code:write("  ", name, ".reset();\n")
+    end
+  end
+
+  code:write("}\n\n\n")
+end
+
+
+function generateConsume(code, rule, storage, parallel)
+  -- the pool overload stays native so that it can hand elements out
+  local programs = {}
+  local native = #rule.pattern
+  if isBytecode(rule) and not parallel then
+    for i = 1, #rule.pattern do
+      programs[i] = compileBytecode(rule.pattern[i], storage, rule)
+      if programs[i] ~= nil then
+        native = native - 1
+      end
+    end
+    if native > 0 and Bytecode[rule.name] ~= nil then
+      io.write("Rule '", rule.name, "' has stages bytecode cannot express, they stay native\n")
+    end
+  end
+
+  code:write(Inline, "std::ssize_t ", rule.name, "::consume(const std::uint8_t *_raw__, std::size_t _max__")
+  if parallel then
+    code:write(", nyx::workers &_pool__")
+  elseif Options.streaming then
+    code:write(", bool _last__")
+  end
+  code:write(") {\n")
+  if parallel and Options.streaming then
+    code:write("  const bool _last__ = true;\n")
+  end
+  for i = 1, #rule.pattern do
+    if programs[i] == nil and hasRepeatLoop(rule.pattern[i], storage) then
+      code:write("  int _rep__;\n")
+      break
+    end
+  end
+  code:write("  std::ssize_t _idx__ = 0;\n")
+  if Options.instrument then
+    generateCounters(code, rule)
+  end
+  if rule.decode ~= nil then
+    code:write("  std::ssize_t _start__;\n")
+  end
+  if Options.streaming then
+    code:write("  std::size_t _need__ = 0;\n")
+  end
+  code:write("\n")
+
+  if #rule.pattern > 1 and rule.minsize > 0 then
+    code:write("  if(", lacks(rule.minsize, "_max__"), ") {\n",
+               "    return ", failure(), ";\n",
+               "  }\n\n")
+  end
+
+  local guards = generateDispatch(code, rule)
+
+  for i = 1, #rule.pattern - 1, 1 do
+    generateConsumeAlternate(code, rule.pattern[i], storage, rule.decode, rule.validate, guards[i],
+                             parallel, programs[i])
+    -- the next alternate starts over from the beginning of the input
+    code:write("  _idx__ = 0;\n\n")
+  end
+  generateConsumeAlternate(code, rule.pattern[#rule.pattern], storage, rule.decode, rule.validate,
+                           guards[#rule.pattern], parallel, programs[#rule.pattern])
+  if Counters ~= nil then
+    code:write("  _prof__.hit(", Counters["failed"], ");\n")
+    Counters = nil
+  end
+  code:write("  return ", failure(), ";\n}\n\n\n");
+end
+
+
 function execute(plan)
   local root = ''
 
+  Options = plan.options
+
+  if Options.streaming and Options.views then
+    io.write("Option 'views' cannot be combined with 'streaming', ignoring it\n")
+    Options.views = nil
+  end
+
+  if Options.arena and Options.parallel then
+    io.write("Option 'parallel' cannot be combined with 'arena', ignoring it\n")
+    Options.parallel = nil
+  end
+
+  if Options.arena and Options.recycle then
+    io.write("Option 'recycle' cannot be combined with 'arena', ignoring it\n")
+    Options.recycle = nil
+  end
+
+  if Options.streaming and Options.lazy then
+    io.write("Option 'lazy' cannot be combined with 'streaming', ignoring it\n")
+    Options.lazy = nil
+  end
+
+  if Options.streaming and Options.bytecode then
+    io.write("Option 'bytecode' cannot be combined with 'streaming', ignoring it\n")
+    Options.bytecode = nil
+  end
+
+  Inline = ''
+  if Options['header-only'] then
+    Inline = 'inline '
+  end
+
+  Profile = {}
+  if type(Options.profile) == 'string' then
+    local file = io.open(Options.profile, "r")
+
+    if file == nil then
+      io.write("Failure to read profile: '", Options.profile, "'\n")
+    else
+      for line in file:lines() do
+        local rule, label, count = string.match(line, "^(%S+) (.-) (%d+)$")
+
+        if rule ~= nil then
+          Profile[rule] = Profile[rule] or {}
+          Profile[rule][label] = (Profile[rule][label] or 0) + tonumber(count)
+        end
+      end
+      file:close()
+    end
+  end
+
+  Bytecode = {}
+  if type(Options.bytecode) == 'string' then
+    for name in string.gmatch(Options.bytecode, "[^,]+") do
+      Bytecode[name] = true
+    end
+  end
+
+  Columnar = {}
+  if type(Options.columnar) == 'string' then
+    for name in string.gmatch(Options.columnar, "[^,]+") do
+      Columnar[name] = true
+    end
+  elseif Options.columnar then
+    io.write("Option 'columnar' needs the rules to store by column, as columnar=rule,...\n")
+  end
+
+  Scanner = {}
+  if type(Options.scanner) == 'string' then
+    for name in string.gmatch(Options.scanner, "[^,]+") do
+      Scanner[name] = true
+    end
+  elseif Options.scanner then
+    io.write("Option 'scanner' needs the rules to scan for, as scanner=rule,...\n")
+  end
+
+  Lazy = {}
+  if type(Options.lazy) == 'string' then
+    for member in string.gmatch(Options.lazy, "[^,]+") do
+      Lazy[member] = true
+    end
+  end
+
   if plan.options.outdir ~= nil then
     root = plan.options.outdir .. '/'
   end
@@ -567,8 +3035,25 @@ function execute(plan)
 
     generateUsing(code, namespace.imports)
 
+    Rules = {}
+    for j = 1, #namespace do
+      Rules[namespace[j].name] = namespace[j]
+    end
+
+    local scanned = {}
     for j = 1, #namespace do
       generateRuleClass(header, code, namespace[j], namespace.namespace)
+      if namespace[j].prefixes ~= nil then
+        scanned[#scanned + 1] = namespace[j]
+      end
+    end
+
+    if #scanned > 0 then
+      generateNamespaceSeek(header, code, scanned, namespace.namespace)
+    end
+
+    if Options['header-only'] then
+      header:write(code:text())
     end
 
     closeNamespace(header, namespace.namespace)
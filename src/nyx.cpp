@@ -21,6 +21,7 @@ struct Settings {
     inputs(),
     outdir("."),
     options(),
+    profile(),
     sysroot(DEFAULT_SYSROOT),
     language(DEFAULT_LANGUAGE),
     includes() {
@@ -29,6 +30,7 @@ struct Settings {
   std::vector<std::string> inputs;
   std::string              outdir;
   std::vector<std::string> options;
+  std::string              profile;
   std::string              sysroot;
   std::string              language;
   std::vector<std::string> includes;
@@ -72,7 +74,7 @@ int main(int argc, char **argv) {
 }
 
 
-static const std::array<struct option, 10> LOPTS{
+static const std::array<struct option, 11> LOPTS{
   option{ "help",     no_argument,       nullptr, 'h' }, // print help and exit
   option{ "include",  required_argument, nullptr, 'I' }, // add a user include directory
   option{ "lang",     required_argument, nullptr, 'l' }, // select output language
@@ -80,13 +82,14 @@ static const std::array<struct option, 10> LOPTS{
   option{ "outdir",   required_argument, nullptr, 'o' }, // select base output directory
   option{ "opt",      required_argument, nullptr, 'O' }, // specify a language specific option
   option{ "option",   required_argument, nullptr, 'O' }, // specify a language specific option
+  option{ "profile",  required_argument, nullptr, 'p' }, // feed back counts from an instrumented run
   option{ "sysroot",  required_argument, nullptr, 'S' }, // change the system include directory
   option{ "ver",      no_argument,       nullptr, 'v' }, // print version info and exit
   option{ "version",  no_argument,       nullptr, 'v' }  // print version info and exit
 };
 
 
-static const char *SHOPTS = "hI:l:O:o:S:v";
+static const char *SHOPTS = "hI:l:O:o:p:S:v";
 
 
 static void processCommandLine(Settings &settings, int argc, char **argv) {
@@ -97,13 +100,14 @@ static void processCommandLine(Settings &settings, int argc, char **argv) {
     switch(opt) {
       case 'h':
         std::cout <<
-          "Usage: " << *argv << " [hIlOoSv]" << std::endl <<
+          "Usage: " << *argv << " [hIlOopSv]" << std::endl <<
           "  Where: " << std::endl <<
           "    -h, --help                    print this message and exit" << std::endl <<
           "    -I, --include DIR             add a directory to search for imports" << std::endl <<
           "    -l, --lang, --language LANG   select an output language" << std::endl <<
           "    -o, --outdir DIR              specify the base output directory" << std::endl <<
           "    -O, --opt, --option OPT       pass an option to the output plugin" << std::endl <<
+          "    -p, --profile FILE            order branches by the counts an instrumented build saved" << std::endl <<
           "    -S, --sysroot DIR             specify the system import directory" << std::endl <<
           "    -v, --ver, --version          print the version and exit" << std::endl;
         shouldExit = true;
@@ -125,6 +129,10 @@ static void processCommandLine(Settings &settings, int argc, char **argv) {
         settings.options.emplace_back(optarg);
       break;
 
+      case 'p':
+        settings.profile.assign(optarg);
+      break;
+
       case 'S':
         settings.sysroot.assign(optarg);
       break;
@@ -152,6 +160,11 @@ static void processCommandLine(Settings &settings, int argc, char **argv) {
     settings.options.emplace_back(outdir);
   }
 
+  // and the profile, for the plugin to read
+  if(!settings.profile.empty()) {
+    settings.options.emplace_back("profile=" + settings.profile);
+  }
+
   for(int arg = optind; arg < argc; ++arg) {
     settings.inputs.emplace_back(argv[arg]);
   }
@@ -4,7 +4,9 @@
 #include <set>
 #include <string>
 #include <vector>
+#include <ctype.h>
 #include <stddef.h>
+#include <iterator>
 #include <algorithm>
 
 
@@ -64,17 +66,68 @@ void Stage::assignMetadata(const AbstractPatternElement &element) {
 
 
 Stage::Stage():
-  what(Lexeme::INVALID) {
+  what(Lexeme::INVALID),
+  width(-1),
+  least(0) {
 }
 
 
-Stage::Stage(const AbstractMatchElement &match) {
-  ref = match.discriminant()->toString();
+static uint64_t caseKey(const Token &token) {
+  if(token.lexeme() == Lexeme::BinaryLiteral) {
+    return std::stoull(token.text().substr(2), nullptr, 2);
+  }
+  else if(token.lexeme() == Lexeme::HexadecimalLiteral) {
+    return std::stoull(token.text(), nullptr, 16);
+  }
+  else if(token.lexeme() == Lexeme::OctalLiteral) {
+    return std::stoull(token.text(), nullptr, 8);
+  }
+
+  return std::stoull(token.text());
+}
 
+
+// sorts the cases of a match into single keys and ranges, false when one is
+// empty or overlaps another
+static bool matchCases(const AbstractMatchElement                         &match,
+                       std::map<uint64_t, std::string>                    &select,
+                       std::map<uint64_t, std::pair<uint64_t, std::string>> &spans) {
   for(auto &element : match) {
-    select.emplace(std::stoi(element->key()->text()), element->value()->toString());
+    auto first = caseKey(*element->key());
+    auto last  = element->isRange() ? caseKey(*element->last()) : first;
+    auto key   = select.lower_bound(first);
+    auto next  = spans.upper_bound(last);
+
+    if(last < first) {
+      std::cerr << "Empty match range: " << first << ".." << last << std::endl;
+      return false;
+    }
+    else if((key != select.end() && key->first <= last) ||
+            (next != spans.begin() && std::prev(next)->second.first >= first)) {
+      std::cerr << "Overlapping match case: " << first << std::endl;
+      return false;
+    }
+    else if(element->isRange()) {
+      spans.emplace(first, std::make_pair(last, element->value()->toString()));
+    }
+    else {
+      select.emplace(first, element->value()->toString());
+    }
   }
 
+  return true;
+}
+
+
+Stage::Stage(const AbstractMatchElement &match):
+  what(Lexeme::INVALID),
+  width(-1),
+  least(0) {
+  ref = match.discriminant()->toString();
+
+  // already checked while tracing dependencies
+  matchCases(match, select, spans);
+
   assignMetadata(match);
 }
 
@@ -183,7 +236,9 @@ static void literalHandler(std::vector<uint8_t> &exact, const Token &token) {
 
 Stage::Stage(const AbstractSimplePatternElement &simple):
   stage(nullptr),
-  sub(nullptr) {
+  sub(nullptr),
+  width(-1),
+  least(0) {
 
   if(simple.isToken()) {
     switch(what = simple.token()->lexeme()) {
@@ -260,7 +315,10 @@ static auto make_stage(const AbstractPatternElement &pat) {
 
 
 Stage::Stage(const nyx::syntax::AbstractCompoundPatternElement &compound):
-  stage(nullptr) {
+  stage(nullptr),
+  what(Lexeme::INVALID),
+  width(-1),
+  least(0) {
 
   auto iter = compound.begin();
   sub = make_stage(**iter);
@@ -312,7 +370,9 @@ Stage::Stage(const std::vector<uint8_t> &vec,
   min(minimum),
   max(maximum),
   exact(vec),
-  what(Lexeme::INVALID) {
+  what(Lexeme::INVALID),
+  width(-1),
+  least(0) {
 }
 
 
@@ -326,7 +386,11 @@ Stage::Stage(const Stage &that):
   ref(that.ref),
   wild(that.wild),
   select(that.select),
-  what(that.what) {
+  spans(that.spans),
+  what(that.what),
+  width(that.width),
+  least(that.least),
+  lead(that.lead) {
 }
 
 Stage& Stage::operator=(const Stage &that) {
@@ -339,7 +403,13 @@ Stage& Stage::operator=(const Stage &that) {
   ref =    that.ref;
   wild =   that.wild;
   select = that.select;
+  spans =  that.spans;
   what =   that.what;
+  width =  that.width;
+  least =  that.least;
+  lead =   that.lead;
+
+  return *this;
 }
 
 
@@ -381,7 +451,9 @@ Rule::Rule(const AbstractRuleElement &rule):
   store(rule.storage()),
   enc(rule.encode()),
   dec(rule.decode()),
-  val(rule.validation())
+  val(rule.validation()),
+  width(-1),
+  least(0)
 {
 
 }
@@ -561,6 +633,13 @@ static bool traceDependencies(Registry
                               const AbstractNamespaceElement                     &ns,
                               AbstractMatchElement                               &match,
                               Dependency                                         &dep) {
+  std::map<uint64_t, std::string> select;
+  std::map<uint64_t, std::pair<uint64_t, std::string>> spans;
+
+  if(!matchCases(match, select, spans)) {
+    return false;
+  }
+
   for(auto &mc : match) {
     if(!traceDependencies(reg, deps, ns, *mc->value(), dep)) {
       return false;
@@ -691,6 +770,190 @@ static void add(std::set<std::string>
 }
 
 
+namespace nyx {
+
+
+// static size and first byte analysis of every stage and rule in a plan
+class Measure {
+  public:
+    Measure(std::vector<Namespace> &spaces) {
+      for(auto &ns : spaces) {
+        std::string name;
+        for(auto &part : ns.parts()) {
+          name.append(name.empty() ? "" : ".").append(part);
+        }
+
+        for(auto &rule : ns.rules()) {
+          rules.emplace(name + "." + rule.name(), std::make_pair(&rule, name));
+        }
+      }
+    }
+
+    void run() {
+      for(auto &entry : rules) {
+        measure(*entry.second.first, entry.second.second);
+      }
+    }
+
+  protected:
+    void measure(Rule &rule, const std::string &ns) {
+      if(done.find(&rule) != done.end() || active.find(&rule) != active.end()) {
+        return;
+      }
+
+      active.emplace(&rule);
+
+      auto &alternates = rule.pattern().alternates();
+      for(auto iter = alternates.begin(), end = alternates.end(); iter != end; ++iter) {
+        auto &root = iter->pattern();
+        measure(root, ns);
+        rule.lead |= root.lead;
+
+        if(iter == alternates.begin()) {
+          rule.width = root.width;
+          rule.least = root.least;
+        }
+        else {
+          if(rule.width != root.width) {
+            rule.width = -1;
+          }
+          rule.least = std::min(rule.least, root.least);
+        }
+      }
+
+      active.erase(&rule);
+      done.emplace(&rule);
+    }
+
+    void measure(Stage &stage, const std::string &ns) {
+      int64_t width = 0;
+      uint64_t least = 0;
+
+      if(stage.isPrimitive()) {
+        width = least = stage.exact.size();
+        stage.lead.set(stage.exact[0]);
+      }
+      else if(stage.isWildcard()) {
+        width = least = 1;
+        for(unsigned val = 0; val < 256; ++val) {
+          if((val & stage.wild.first) == stage.wild.second) {
+            stage.lead.set(val);
+          }
+        }
+      }
+      else if(stage.isCompound()) {
+        bool leading = true;
+
+        for(auto ptr = stage.sub.get(); ptr; ptr = ptr->stage.get()) {
+          measure(*ptr, ns);
+
+          // stages that may match nothing let the next one start the group
+          if(leading) {
+            stage.lead |= ptr->lead;
+            leading = ptr->least == 0;
+          }
+
+          least += ptr->least;
+          width = (width >= 0 && ptr->width >= 0) ? width + ptr->width : -1;
+        }
+      }
+      else if(stage.isMatch()) {
+        bool first = true;
+
+        std::vector<std::string> types;
+        for(auto &entry : stage.select) {
+          types.push_back(entry.second);
+        }
+        for(auto &entry : stage.spans) {
+          types.push_back(entry.second.second);
+        }
+
+        for(auto &type : types) {
+          int64_t caseWidth;
+          uint64_t caseLeast;
+          std::bitset<256> caseLead;
+          reference(ns, type, caseWidth, caseLeast, caseLead);
+          stage.lead |= caseLead;
+
+          if(first) {
+            width = caseWidth;
+            least = caseLeast;
+            first = false;
+          }
+          else {
+            width = width == caseWidth ? width : -1;
+            least = std::min(least, caseLeast);
+          }
+        }
+      }
+      else {
+        reference(ns, stage.ref, width, least, stage.lead);
+      }
+
+      if(isdigit(stage.min[0])) {
+        auto reps = std::stoull(stage.min);
+        stage.least = least * reps;
+        stage.width = (width >= 0 && stage.min == stage.max) ? width * reps : -1;
+      }
+      else {
+        // repeat count is only known once decoded
+        stage.least = 0;
+        stage.width = -1;
+      }
+    }
+
+    void reference(const std::string &ns, const std::string &name,
+                   int64_t &width, uint64_t &least, std::bitset<256> &lead) {
+      static const std::map<std::string, int64_t> builtins{
+        { "u8",   1 }, { "i8",   1 },
+        { "u16",  2 }, { "u16l", 2 }, { "u16b", 2 },
+        { "i16",  2 }, { "i16l", 2 }, { "i16b", 2 },
+        { "u32",  4 }, { "u32l", 4 }, { "u32b", 4 },
+        { "i32",  4 }, { "i32l", 4 }, { "i32b", 4 },
+        { "f32",  4 }, { "f32l", 4 }, { "f32b", 4 },
+        { "u64",  8 }, { "u64l", 8 }, { "u64b", 8 },
+        { "i64",  8 }, { "i64l", 8 }, { "i64b", 8 },
+        { "f64",  8 }, { "f64l", 8 }, { "f64b", 8 }
+      };
+
+      auto builtin = builtins.find(name);
+      if(builtin != builtins.end()) {
+        width = least = builtin->second;
+        lead.set();
+        return;
+      }
+
+      auto iter = rules.find(ns + "." + name);
+      if(iter == rules.end()) {
+        iter = rules.find(name);
+      }
+
+      if(iter != rules.end()) {
+        measure(*iter->second.first, iter->second.second);
+
+        if(done.find(iter->second.first) != done.end()) {
+          width = iter->second.first->width;
+          least = iter->second.first->least;
+          lead  = iter->second.first->lead;
+          return;
+        }
+      }
+
+      // unresolved or recursive, assume nothing
+      width = -1;
+      least = 0;
+      lead.set();
+    }
+
+    std::map<std::string, std::pair<Rule *, std::string>> rules;
+    std::set<const Rule *>                                active;
+    std::set<const Rule *>                                done;
+};
+
+
+}
+
+
 std::unique_ptr<Plan> Plan::generate(Registry &reg) {
   // multi root dependency tree
   std::map<std::string, std::shared_ptr<Dependency>> deps;
@@ -739,6 +1002,9 @@ std::unique_ptr<Plan> Plan::generate(Registry &reg) {
     }
   }
 
+  // work out how many bytes each rule and stage consumes
+  Measure(plan->spaces).run();
+
   return plan;
 }
 
@@ -84,7 +84,7 @@ static const char *toSize(const std::string &type) {
 }
 
 
-static void translateStage(std::string &script, const Stage &stage) {
+static void translateStage(std::string &script, const Stage &stage, bool alternate = false) {
   script.append("          {\n");
   if(stage.isPrimitive()) {
     script.append("            type = \"ExactMatch\",\n");
@@ -122,6 +122,15 @@ static void translateStage(std::string &script, const Stage &stage) {
       script.append("              [").append(std::to_string(val.first)).append("] = \"");
       script.append(val.second).append("\",\n");
     }
+    if(stage.ranges().size() > 0) {
+      script.append("              ranges = {\n");
+      for(auto &val : stage.ranges()) {
+        script.append("                { ").append(std::to_string(val.first)).append(", ");
+        script.append(std::to_string(val.second.first)).append(", \"");
+        script.append(val.second.second).append("\" },\n");
+      }
+      script.append("              },\n");
+    }
     script.append("            },\n");
   }
   else {
@@ -190,6 +199,20 @@ static void translateStage(std::string &script, const Stage &stage) {
   else {
     script.append("            maximum = ").append(stage.maximum()).append(",\n");
   }
+  if(stage.isFixedSize()) {
+    script.append("            size = ").append(std::to_string(stage.fixedSize())).append(",\n");
+  }
+  script.append("            minsize = ").append(std::to_string(stage.minimumSize())).append(",\n");
+  // alternates that may start with any byte, or match nothing at all, get no set
+  if(alternate && stage.minimumSize() > 0 && !stage.firstBytes().all()) {
+    script.append("            first = { ");
+    for(unsigned val = 0; val < 256; ++val) {
+      if(stage.firstBytes().test(val)) {
+        script.append(std::to_string(val)).append(", ");
+      }
+    }
+    script.append("},\n");
+  }
   if(stage.hasName()) {
     script.append("            ident = \"").append(stage.name()).append("\",\n");
   }
@@ -200,7 +223,7 @@ static void translateStage(std::string &script, const Stage &stage) {
 static void translatePattern(std::string &script, const Pattern &pattern) {
   script.append("      pattern = {\n");
   for(auto &alt : pattern.alternates()) {
-    translateStage(script, alt.pattern());
+    translateStage(script, alt.pattern(), true);
   }
   script.append("      },\n");
 }
@@ -232,6 +255,11 @@ static void translateSexpr(std::string &script, const AbstractSexpr *sexpr) {
         case Lexeme::CloseAngle:
         case Lexeme::Division:
         case Lexeme::Equality:
+        case Lexeme::GreaterThanOrEqual:
+        case Lexeme::Inequality:
+        case Lexeme::LessThanOrEqual:
+        case Lexeme::LogicalAnd:
+        case Lexeme::LogicalOr:
         case Lexeme::Minus:
         case Lexeme::Modulo:
         case Lexeme::OpenAngle:
@@ -288,6 +316,10 @@ static void translateValidation(std::string &script, const Code &code) {
 static void translateRule(std::string &script, const Rule &rule) {
   script.append("    {\n");
   script.append("      name = \"").append(rule.name()).append("\",\n");
+  if(rule.isFixedSize()) {
+    script.append("      size = ").append(std::to_string(rule.fixedSize())).append(",\n");
+  }
+  script.append("      minsize = ").append(std::to_string(rule.minimumSize())).append(",\n");
   translatePattern(script, rule.pattern());
   if(rule.hasStorage()) {
     translateStorage(script, rule.storage());
@@ -488,6 +488,16 @@ AbstractMatchCaseElement::AbstractMatchCaseElement(std::shared_ptr<Token>
 }
 
 
+AbstractMatchCaseElement::AbstractMatchCaseElement(std::shared_ptr<Token>                     key,
+                                                   std::shared_ptr<Token>                     last,
+                                                   std::shared_ptr<AbstractIdentifierElement> value):
+  AbstractElement(AbstractElementType::MatchCase),
+  key_ptr(key),
+  last_ptr(last),
+  value_ptr(value) {
+}
+
+
 AbstractMatchCaseElement::~AbstractMatchCaseElement() {
   // nothing to do here
 }
@@ -495,7 +505,11 @@ AbstractMatchCaseElement::~AbstractMatchCaseElement() {
 
 std::ostream &AbstractMatchCaseElement::print(std::ostream &os) const {
   os << "Case: ";
-  nyx::syntax::operator<<(os, key_ptr)   << " => ";
+  nyx::syntax::operator<<(os, key_ptr);
+  if(last_ptr) {
+    nyx::syntax::operator<<(os << "..", last_ptr);
+  }
+  os << " => ";
   nyx::syntax::operator<<(os, value_ptr);
 
   return os;
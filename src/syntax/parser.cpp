@@ -736,16 +736,19 @@ static int parseRuleEncode(token_iterator &start, token_iterator last, concrete_
 
 
 static std::shared_ptr<ConcreteBoundElement> make_bound(
-    concrete_vector::iterator start, token_iterator token) {
-  concrete_vector parts(start, start + 2);
+    concrete_vector::iterator start, token_iterator token, std::size_t count = 2) {
+  concrete_vector parts(start, start + count);
   parts.emplace_back(toToken(token));
   return std::make_shared<ConcreteBoundElement>(parts);
 }
 
 
-static concrete_vector &compactBinding(concrete_vector &parts, token_iterator token) {
-  auto binding = make_bound(parts.end() - 2, token);
-  parts.resize(parts.size() - 2);
+// fold the count parts before token, the bound element and the bind operator,
+// into a single bound element
+static concrete_vector &compactBinding(concrete_vector &parts, token_iterator token,
+                                       std::size_t count = 2) {
+  auto binding = make_bound(parts.end() - count, token, count);
+  parts.resize(parts.size() - count);
   parts.emplace_back(binding);
   return parts;
 }
@@ -870,6 +873,8 @@ enum class MatchParseState {
   HasHead,
   InBody,
   HasElement,
+  InRange,
+  HasRange,
   Binding,
   HasBoundElement,
   HasRepeatingElement
@@ -881,6 +886,7 @@ parseRulePatternMatch(token_iterator &start, token_iterator last) {
   concrete_vector parts;
   token_iterator  iter = start;
   MatchParseState state = MatchParseState::Ready;
+  bool            ranged = false;
 
   parts.emplace_back(toToken(start));
 
@@ -961,6 +967,39 @@ parseRulePatternMatch(token_iterator &start, token_iterator last) {
           parts.emplace_back(toToken(iter));
           state = MatchParseState::Binding;
         }
+        else if((*iter)->lexeme() == Lexeme::Range) {
+          parts.emplace_back(toToken(iter));
+          state = MatchParseState::InRange;
+        }
+        else {
+          unexpectedToken(*iter);
+          state = MatchParseState::Error;
+        }
+      break;
+
+      case MatchParseState::InRange:
+        switch((*iter)->lexeme()) {
+          case Lexeme::BinaryLiteral:
+          case Lexeme::DecimalLiteral:
+          case Lexeme::HexadecimalLiteral:
+          case Lexeme::OctalLiteral:
+            parts.emplace_back(toToken(iter));
+            state = MatchParseState::HasRange;
+          break;
+
+          default:
+            unexpectedToken(*iter);
+            state = MatchParseState::Error;
+          break;
+        }
+      break;
+
+      case MatchParseState::HasRange:
+        if((*iter)->lexeme() == Lexeme::Bind) {
+          parts.emplace_back(toToken(iter));
+          ranged = true;
+          state = MatchParseState::Binding;
+        }
         else {
           unexpectedToken(*iter);
           state = MatchParseState::Error;
@@ -969,7 +1008,8 @@ parseRulePatternMatch(token_iterator &start, token_iterator last) {
 
       case MatchParseState::Binding:
         if((*iter)->lexeme() == Lexeme::Identifier) {
-          compactBinding(parts, iter);
+          compactBinding(parts, iter, ranged ? 4 : 2);
+          ranged = false;
           state = MatchParseState::HasBoundElement;
         }
         else {
@@ -1904,18 +1944,25 @@ static std::shared_ptr<Token> convertTokenOrIdentifier(ConcreteElement &concrete
 
 static std::shared_ptr<AbstractMatchCaseElement>
 convertMatchCase(ConcreteBoundElement &binding) {
-  if(binding.size() == 3) {
-    auto key = binding[0], value = binding[2];
+  if(binding.size() == 3 || binding.size() == 5) {
+    auto key = binding[0], last = binding.size() == 5 ? binding[2] : nullptr;
+    auto value = binding[binding.size() - 1];
 
     if(key   && key->type()   == ConcreteElementType::Token &&
-       value && value->type() == ConcreteElementType::Token) {
+       value && value->type() == ConcreteElementType::Token &&
+       (!last || last->type() == ConcreteElementType::Token)) {
       auto key_token    = as<ConcreteTokenElement>(key).token();
+      auto last_token   = last ? as<ConcreteTokenElement>(last).token() : nullptr;
       auto &value_token = as<ConcreteTokenElement>(value);
 
-      if(key_token->isNumeric() || key_token->is(Lexeme::StringLiteral)) {
+      if(last_token && !last_token->isNumeric()) {
+        unexpectedToken(last_token);
+      }
+      else if(key_token->isNumeric() || (!last_token && key_token->is(Lexeme::StringLiteral))) {
         if(value_token.token()->is(Lexeme::Identifier)) {
           return std::make_shared<AbstractMatchCaseElement>(
             key_token,
+            last_token,
             convertIdentifier(value_token)
           );
         }
@@ -101,6 +101,7 @@ const char *nyx::syntax::toString(Lexeme lexeme) {
     PRINT_ENUM(OrAssignment);
     PRINT_ENUM(Pattern);
     PRINT_ENUM(PlusAssignment);
+    PRINT_ENUM(Range);
     PRINT_ENUM(RightShift);
     PRINT_ENUM(Storage);
     PRINT_ENUM(StringLiteral);
@@ -60,6 +60,9 @@ std::shared_ptr<Token> Tokenizer::next() {
         if(end < len && std::isdigit(str[end])) {
           return parseNumber(str, len);
         }
+        else if(end < len && str[end] == '.') {
+          return emitToken(Lexeme::Range, 2);
+        }
         else {
           return emitToken(Lexeme::Dot, 1);
         }
@@ -239,6 +242,13 @@ static bool contains(const std::array<T, N> &arr, const T &val) {
 }
 
 
+// true when the character at pos begins a range operator, which ends any
+// integer literal before it rather than starting a fraction
+static bool startsRange(const std::string &str, int len, int pos) {
+  return str[pos] == '.' && pos + 1 < len && str[pos + 1] == '.';
+}
+
+
 std::shared_ptr<Token> Tokenizer::parseNumber(const std::string &str, int len) {
   NumberState state = NumberState::Start;
 
@@ -285,10 +295,11 @@ std::shared_ptr<Token> Tokenizer::parseNumber(const std::string &str, int len) {
         else if(str[end] == '*') {
           state = NumberState::OctalPattern;
         }
-        else if(str[end] == '.') {
+        else if(str[end] == '.' && !startsRange(str, len, end)) {
           state = NumberState::FractionStart;
         }
-        else if(std::isspace(str[end]) || contains(DELIMITERS, str[end])) {
+        else if(std::isspace(str[end]) || contains(DELIMITERS, str[end]) ||
+                startsRange(str, len, end)) {
           return emitToken(Lexeme::DecimalLiteral, end - column);
         }
         else {
@@ -300,13 +311,14 @@ std::shared_ptr<Token> Tokenizer::parseNumber(const std::string &str, int len) {
         if('0' <= str[end] && str[end] <= '9') {
           state = NumberState::Decimal;
         }
-        else if(str[end] == '.') {
+        else if(str[end] == '.' && !startsRange(str, len, end)) {
           state = NumberState::FractionStart;
         }
         else if(str[end] == 'E' || str[end] == 'e') {
           state = NumberState::Exponent;
         }
-        else if(std::isspace(str[end]) || contains(DELIMITERS, str[end])) {
+        else if(std::isspace(str[end]) || contains(DELIMITERS, str[end]) ||
+                startsRange(str, len, end)) {
           return emitToken(Lexeme::DecimalLiteral, end - column);
         }
         else {
@@ -321,7 +333,8 @@ std::shared_ptr<Token> Tokenizer::parseNumber(const std::string &str, int len) {
         else if(str[end] == '*') {
           state = NumberState::OctalPattern;
         }
-        else if(std::isspace(str[end]) || contains(DELIMITERS, str[end])) {
+        else if(std::isspace(str[end]) || contains(DELIMITERS, str[end]) ||
+                startsRange(str, len, end)) {
           return emitToken(Lexeme::OctalLiteral, end - column);
         }
         else {
@@ -360,7 +373,8 @@ std::shared_ptr<Token> Tokenizer::parseNumber(const std::string &str, int len) {
         else if(str[end] == '*') {
           state = NumberState::BinaryPattern;
         }
-        else if(std::isspace(str[end]) || contains(DELIMITERS, str[end])) {
+        else if(std::isspace(str[end]) || contains(DELIMITERS, str[end]) ||
+                startsRange(str, len, end)) {
           return emitToken(Lexeme::BinaryLiteral, end - column);
         }
         else {
@@ -403,7 +417,8 @@ std::shared_ptr<Token> Tokenizer::parseNumber(const std::string &str, int len) {
         else if(str[end] == '*') {
           state = NumberState::HexadecimalPattern;
         }
-        else if(std::isspace(str[end]) || contains(DELIMITERS, str[end])) {
+        else if(std::isspace(str[end]) || contains(DELIMITERS, str[end]) ||
+                startsRange(str, len, end)) {
           return emitToken(Lexeme::HexadecimalLiteral, end - column);
         }
         else {
@@ -603,6 +618,7 @@ const std::map<std::string, Lexeme> Tokenizer::KEYWORDS = {
  { "pattern:",   Lexeme::Pattern            },
  { "+",          Lexeme::Plus               },
  { "+=",         Lexeme::PlusAssignment     },
+ { "..",         Lexeme::Range              },
  { ">>",         Lexeme::RightShift         },
  { "storage:",   Lexeme::Storage            },
  { "*",          Lexeme::Times              },